@@ -0,0 +1,77 @@
+#ifndef ARENA_AST
+#define ARENA_AST
+
+#include <llvm/Support/Allocator.h>
+
+#include "symbol.hpp"
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace spc
+{
+    // Owns every AST node of one compilation. Nodes are bump-allocated and all freed at once
+    // when the arena dies; everything else in the AST only holds plain, non-owning pointers.
+    class ASTArena
+    {
+    private:
+        llvm::BumpPtrAllocator allocator;
+        SymbolPool symbols{allocator};
+        // Destructors of the nodes that have one, run in reverse order of construction
+        std::vector<std::pair<void *, void (*)(void *)>> dtors;
+
+        static ASTArena *&current()
+        {
+            static thread_local ASTArena *arena = nullptr;
+            return arena;
+        }
+
+    public:
+        ASTArena() = default;
+        ~ASTArena()
+        {
+            for (auto it = dtors.rbegin(); it != dtors.rend(); ++it)
+                it->second(it->first);
+        }
+        ASTArena(const ASTArena &) = delete;
+        ASTArena &operator=(const ASTArena &) = delete;
+
+        template<typename T, typename... Args>
+        T *create(Args&&... args)
+        {
+            T *node = new (allocator.Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value)
+                dtors.emplace_back(node, [](void *p) { static_cast<T *>(p)->~T(); });
+            return node;
+        }
+
+        Symbol intern(llvm::StringRef name) { return symbols.intern(name); }
+        size_t getSymbolCount() const { return symbols.size(); }
+
+        size_t getBytesAllocated() const { return allocator.getBytesAllocated(); }
+
+        // make_node allocates from the arena installed on the current thread.
+        // Scopes nest, so one thread may work on several compilations in turn.
+        class Scope
+        {
+        private:
+            ASTArena *prev;
+        public:
+            explicit Scope(ASTArena &arena) : prev(current()) { current() = &arena; }
+            ~Scope() { current() = prev; }
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+        };
+
+        static ASTArena &get()
+        {
+            assert(current() != nullptr && "AST nodes must be created inside an ASTArena::Scope");
+            return *current();
+        }
+    };
+
+} // namespace spc
+
+#endif
@@ -29,15 +29,43 @@
 #include <memory>
 #include <iostream>
 #include "utils/utils.hpp"
+#include "arena.hpp"
 
 namespace spc
 {
     class CodegenContext;
+    class TypeNode;
+
+    // Dynamic type of a node, tested by the classof of each node class so that
+    // is_ptr_of / cast_node need no RTTI. The kinds of the subclasses of an abstract
+    // node are contiguous, so classof of the abstract node is a range check.
+    enum class NodeKind
+    {
+        List,
+        // ExprNode
+        BinaryExpr, FormatExpr,
+        CustomProc, SysProc,                        // ProcNode
+        Boolean, Integer, Real, Char, String,       // ConstValueNode
+        ArrayRef, RecordRef, Identifier,            // LeftExprNode
+        // StmtNode
+        IfStmt, WhileStmt, ForStmt, RepeatStmt, ProcStmt, AssignStmt, CaseBranch, CaseStmt,
+        // DeclNode
+        VarDecl, ConstDecl, TypeDecl, Param,
+        // TypeNode
+        VoidType, SimpleType, StringType, AliasType, RecordType, ArrayType,
+        RoutineHead,
+        // BaseRoutineNode
+        Routine, Program, Unit
+    };
+
     class BaseNode
     {
+    private:
+        const NodeKind kind;
     public:
-        BaseNode() {}
-        ~BaseNode() {}
+        explicit BaseNode(const NodeKind kind) : kind(kind) {}
+        virtual ~BaseNode() {}
+        NodeKind getKind() const { return kind; }
         virtual llvm::Value *codegen(CodegenContext &) = 0;
         // virtual void print() = 0;
     };
@@ -46,31 +74,22 @@ namespace spc
     class ListNode: public BaseNode
     {
     private:
-        std::list<std::shared_ptr<T>> children;
+        std::list<T *> children;
     public:
-        ListNode() {}
-        ListNode(const std::shared_ptr<T> &val) { children.push_back(val); }
-        ListNode(std::shared_ptr<T> &&val) { children.push_back(val); }
+        ListNode() : BaseNode(NodeKind::List) {}
+        ListNode(T *val) : BaseNode(NodeKind::List) { children.push_back(val); }
         ~ListNode() {}
 
-        std::list<std::shared_ptr<T>> &getChildren() { return children; }
+        std::list<T *> &getChildren() { return children; }
 
-        void append(const std::shared_ptr<T> &val) { children.push_back(val); }
-        void append(std::shared_ptr<T> &&val) { children.push_back(val); }
+        void append(T *val) { children.push_back(val); }
 
-        void merge(const std::shared_ptr<ListNode<T>> &rhs)
+        // Moves the children of rhs to the end of this list, rhs is left empty
+        void merge(ListNode<T> *rhs)
         {
-            for (auto &c: rhs->children)
-            {
-                children.push_back(c);
-            }
-            // children.merge(std::move(rhs->children));
-        }
-        void merge(std::shared_ptr<ListNode<T>> &&rhs)
-        {
-            children.merge(std::move(rhs->children));
+            children.splice(children.end(), rhs->children);
         }
-        void mergeList(const std::list<std::shared_ptr<T>> &lst)
+        void mergeList(const std::list<T *> &lst)
         {
             for (auto &c: lst)
             {
@@ -78,9 +97,9 @@ namespace spc
             }
             // children.merge(std::move(lst));
         }
-        void mergeList(std::list<std::shared_ptr<T>> &&lst)
+        void mergeList(std::list<T *> &&lst)
         {
-            children.merge(std::move(lst));
+            children.splice(children.end(), lst);
         }
         virtual llvm::Value *codegen(CodegenContext &context)
         {
@@ -94,8 +113,12 @@ namespace spc
     class ExprNode: public BaseNode
     {
     public:
-        ExprNode() {}
+        explicit ExprNode(const NodeKind kind) : BaseNode(kind) {}
         ~ExprNode() {}
+        static bool classof(const BaseNode *node) 
+        { 
+            return node->getKind() >= NodeKind::BinaryExpr && node->getKind() <= NodeKind::Identifier; 
+        }
         virtual llvm::Value *codegen(CodegenContext &context) = 0;
         // virtual void print() = 0;
     };
@@ -103,27 +126,37 @@ namespace spc
     class LeftExprNode: public ExprNode
     {
     public:
-        LeftExprNode() {}
+        explicit LeftExprNode(const NodeKind kind) : ExprNode(kind) {}
         ~LeftExprNode() = default;
+        static bool classof(const BaseNode *node) 
+        { 
+            return node->getKind() >= NodeKind::ArrayRef && node->getKind() <= NodeKind::Identifier; 
+        }
         virtual llvm::Value *codegen(CodegenContext &context) = 0;
         virtual llvm::Value *getPtr(CodegenContext &context) = 0;
         virtual llvm::Value *getAssignPtr(CodegenContext &context) = 0;
         virtual const std::string getSymbolName() = 0;
+        // Declared type of the designated object with aliases resolved, nullptr if not aggregate
+        virtual TypeNode *getTypeNode(CodegenContext &context) = 0;
         // virtual void print() = 0;
     };
     
     class StmtNode: public BaseNode
     {
     public:
-        StmtNode() {}
+        explicit StmtNode(const NodeKind kind) : BaseNode(kind) {}
         ~StmtNode() {}
+        static bool classof(const BaseNode *node) 
+        { 
+            return node->getKind() >= NodeKind::IfStmt && node->getKind() <= NodeKind::CaseStmt; 
+        }
         virtual llvm::Value *codegen(CodegenContext &context) = 0;
         // virtual void print() = 0;
     };
     
     template<typename T, typename... Args>
-    std::shared_ptr<T> make_node(Args&&... args) {
-        return std::make_shared<T>(std::forward<Args>(args)...);
+    T *make_node(Args&&... args) {
+        return ASTArena::get().create<T>(std::forward<Args>(args)...);
     }
 
 } // namespace spc
@@ -9,69 +9,87 @@ namespace spc
     class DeclNode: public BaseNode
     {
     public:
-        DeclNode() {}
+        explicit DeclNode(const NodeKind kind) : BaseNode(kind) {}
         ~DeclNode() = default;
+        static bool classof(const BaseNode *node) 
+        { 
+            return node->getKind() >= NodeKind::VarDecl && node->getKind() <= NodeKind::Param; 
+        }
     };
     
     class VarDeclNode: public DeclNode
     {
     private:
-        std::shared_ptr<IdentifierNode> name;
-        std::shared_ptr<TypeNode> type;
+        IdentifierNode *name;
+        TypeNode *type;
     public:
-        VarDeclNode(const std::shared_ptr<IdentifierNode>& name, const std::shared_ptr<TypeNode>& type) : name(name), type(type) {}
+        VarDeclNode(IdentifierNode *name, TypeNode *type) : DeclNode(NodeKind::VarDecl), name(name), type(type) {}
         ~VarDeclNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::VarDecl; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
         friend class ASTvis;
         friend class RecordTypeNode;
-        llvm::Value *createGlobalArray( CodegenContext &context, const std::shared_ptr<ArrayTypeNode> &);
-        llvm::Value *createArray(CodegenContext &context, const std::shared_ptr<ArrayTypeNode> &);
+        friend class UnitNode;
+        friend class UnitInterface;
+        llvm::Value *createGlobalArray( CodegenContext &context, ArrayTypeNode *);
+        llvm::Value *createArray(CodegenContext &context, ArrayTypeNode *);
         friend class CodegenContext;
     };
 
     class ConstDeclNode: public DeclNode
     {
     private:
-        std::shared_ptr<IdentifierNode> name;
-        std::shared_ptr<ConstValueNode> val;
+        IdentifierNode *name;
+        ConstValueNode *val;
     public:
-        ConstDeclNode(const std::shared_ptr<IdentifierNode>& name, const std::shared_ptr<ConstValueNode>& val) : name(name), val(val) {}
+        ConstDeclNode(IdentifierNode *name, ConstValueNode *val) : DeclNode(NodeKind::ConstDecl), name(name), val(val) {}
         ~ConstDeclNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::ConstDecl; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
         friend class ASTvis;
+        friend class UnitNode;
+        friend class UnitInterface;
     };
     
     class TypeDeclNode: public DeclNode
     {
     private:
-        std::shared_ptr<IdentifierNode> name;
-        std::shared_ptr<TypeNode> type;
+        IdentifierNode *name;
+        TypeNode *type;
     public:
-        TypeDeclNode(const std::shared_ptr<IdentifierNode>& name, const std::shared_ptr<TypeNode>& type) : name(name), type(type) {}
+        TypeDeclNode(IdentifierNode *name, TypeNode *type) : DeclNode(NodeKind::TypeDecl), name(name), type(type) {}
         ~TypeDeclNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::TypeDecl; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
         friend class ASTvis;
+        friend class UnitInterface;
     };
 
+    enum ParamMode { ByValue, ByVar, ByConst };
+
     class ParamNode: public DeclNode
     {
     private:
-        std::shared_ptr<IdentifierNode> name;
-        std::shared_ptr<TypeNode> type;
+        IdentifierNode *name;
+        TypeNode *type;
+        ParamMode mode;
     public:
-        ParamNode(const std::shared_ptr<IdentifierNode>& name, const std::shared_ptr<TypeNode>& type) : name(name), type(type) {}
+        ParamNode(IdentifierNode *name, TypeNode *type, const ParamMode mode = ParamMode::ByValue) 
+            : DeclNode(NodeKind::Param), name(name), type(type), mode(mode) {}
         ~ParamNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Param; }
 
         llvm::Value *codegen(CodegenContext &) override { return nullptr; }
         // void print() override;
         friend class ASTvis;
         friend class RoutineNode;
+        friend class UnitInterface;
     };
     
     using TypeDeclList = ListNode<TypeDeclNode>;
@@ -17,15 +17,16 @@ namespace spc
     {
     private:
         BinaryOp op;
-        std::shared_ptr<ExprNode> lhs, rhs;
+        ExprNode *lhs, *rhs;
     public:
         BinaryExprNode(
             const BinaryOp op, 
-            const std::shared_ptr<ExprNode>& lval, 
-            const std::shared_ptr<ExprNode>& rval
+            ExprNode *lval, 
+            ExprNode *rval
             ) 
-            : op(op), lhs(lval), rhs(rval) {}
+            : ExprNode(NodeKind::BinaryExpr), op(op), lhs(lval), rhs(rval) {}
         ~BinaryExprNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::BinaryExpr; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
@@ -33,20 +34,40 @@ namespace spc
         friend class ASTopt;
     };
     
+    // An argument of write/writeln with a field width, and for reals a precision: x:width:precision
+    class FormatExprNode: public ExprNode
+    {
+    private:
+        ExprNode *expr, *width, *precision;
+    public:
+        FormatExprNode(ExprNode *expr, ExprNode *width, ExprNode *precision = nullptr)
+            : ExprNode(NodeKind::FormatExpr), expr(expr), width(width), precision(precision) {}
+        ~FormatExprNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::FormatExpr; }
+
+        // Only write/writeln take formatted arguments, they generate code for the parts
+        llvm::Value *codegen(CodegenContext &) override;
+        friend class SysProcNode;
+    };
+
     class ArrayRefNode: public LeftExprNode
     {
     private:
-        std::shared_ptr<LeftExprNode> arr;
-        std::shared_ptr<ExprNode> index;
+        LeftExprNode *arr;
+        ExprNode *index;
+        // Address of the element in the array at ptr; the index is evaluated here, once
+        llvm::Value *getElementPtr(CodegenContext &context, llvm::Value *ptr);
     public:
-        ArrayRefNode(const std::shared_ptr<LeftExprNode> &arr, const std::shared_ptr<ExprNode> &index)
-            : arr(arr), index(index) {}
+        ArrayRefNode(LeftExprNode *arr, ExprNode *index)
+            : LeftExprNode(NodeKind::ArrayRef), arr(arr), index(index) {}
         ~ArrayRefNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::ArrayRef; }
 
         llvm::Value *codegen(CodegenContext &) override;
         llvm::Value *getPtr(CodegenContext &) override;
         llvm::Value *getAssignPtr(CodegenContext &) override;
         const std::string getSymbolName() override;
+        TypeNode *getTypeNode(CodegenContext &context) override;
         // void print() override;
         friend class ASTvis;
         friend class AssignStmtNode;
@@ -55,17 +76,21 @@ namespace spc
     class RecordRefNode: public LeftExprNode
     {
     private:
-        std::shared_ptr<LeftExprNode> name;
-        std::shared_ptr<IdentifierNode> field;
+        LeftExprNode *name;
+        IdentifierNode *field;
+        // Address of the field in the record at ptr
+        llvm::Value *getFieldPtr(CodegenContext &context, llvm::Value *ptr);
     public:
-        RecordRefNode(const std::shared_ptr<LeftExprNode> &name, const std::shared_ptr<IdentifierNode> &field)
-            : name(name), field(field) {}
+        RecordRefNode(LeftExprNode *name, IdentifierNode *field)
+            : LeftExprNode(NodeKind::RecordRef), name(name), field(field) {}
         ~RecordRefNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::RecordRef; }
 
         llvm::Value *codegen(CodegenContext &) override;
         llvm::Value *getPtr(CodegenContext &) override;
         llvm::Value *getAssignPtr(CodegenContext &) override;
         const std::string getSymbolName() override;
+        TypeNode *getTypeNode(CodegenContext &context) override;
         // void print() override;
         friend class ASTvis;
     };
@@ -73,8 +98,12 @@ namespace spc
     class ProcNode: public ExprNode
     {
     public:
-        ProcNode() = default;
+        explicit ProcNode(const NodeKind kind) : ExprNode(kind) {}
         ~ProcNode() = default;
+        static bool classof(const BaseNode *node) 
+        { 
+            return node->getKind() >= NodeKind::CustomProc && node->getKind() <= NodeKind::SysProc; 
+        }
         llvm::Value *codegen(CodegenContext &context) = 0;
         // void print() = 0;
     };
@@ -82,16 +111,18 @@ namespace spc
     class CustomProcNode: public ProcNode
     {
     private:
-        std::shared_ptr<IdentifierNode> name;
-        std::shared_ptr<ArgList> args;
+        IdentifierNode *name;
+        ArgList *args;
     public:
-        CustomProcNode(const std::string &name, const std::shared_ptr<ArgList> &args = nullptr) 
-            : name(make_node<IdentifierNode>(name)), args(args) {}
-        CustomProcNode(const std::shared_ptr<IdentifierNode> &name, const std::shared_ptr<ArgList> &args = nullptr) 
-            : name(name), args(args) {}
+        CustomProcNode(const std::string &name, ArgList *args = nullptr) 
+            : ProcNode(NodeKind::CustomProc), name(make_node<IdentifierNode>(name)), args(args) {}
+        CustomProcNode(IdentifierNode *name, ArgList *args = nullptr) 
+            : ProcNode(NodeKind::CustomProc), name(name), args(args) {}
         ~CustomProcNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::CustomProc; }
 
         llvm::Value *codegen(CodegenContext &context) override;
+        llvm::Value *getRefArg(CodegenContext &context, ExprNode *arg, llvm::Function *func, unsigned index);
         // void print() override;
         friend class ASTvis;
     };
@@ -102,11 +133,12 @@ namespace spc
     {
     private:
         SysFunc name;
-        std::shared_ptr<ArgList> args;
+        ArgList *args;
     public:
-        SysProcNode(const SysFunc name, const std::shared_ptr<ArgList> &args = nullptr) 
-            : name(name), args(args) {}
+        SysProcNode(const SysFunc name, ArgList *args = nullptr) 
+            : ProcNode(NodeKind::SysProc), name(name), args(args) {}
         ~SysProcNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::SysProc; }
 
         llvm::Value *codegen(CodegenContext &context) override;
         // void print() override;
@@ -2,7 +2,7 @@
 #define IDENTIFIER_AST
 
 #include "base.hpp"
-#include <algorithm>
+#include "symbol.hpp"
 #include <string>
 
 namespace spc
@@ -10,24 +10,24 @@ namespace spc
     class IdentifierNode: public LeftExprNode
     {      
     public:
-        std::string name;
+        // Compare and look up identifiers by symbol; name is its lower-cased spelling
+        const Symbol symbol;
+        const llvm::StringRef name;
+        explicit IdentifierNode(Symbol symbol)
+            : LeftExprNode(NodeKind::Identifier), symbol(symbol), name(symbol.str()) {}
         IdentifierNode(const std::string &str)
-            : name(str) 
-        {
-            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-        }
+            : IdentifierNode(ASTArena::get().intern(str)) {}
         IdentifierNode(const char *str)
-            : name(str) 
-        {
-            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-        }
+            : IdentifierNode(ASTArena::get().intern(str)) {}
         ~IdentifierNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Identifier; }
 
         llvm::Value *codegen(CodegenContext &context) override;
         llvm::Constant *getConstVal(CodegenContext &context);
         llvm::Value *getPtr(CodegenContext &context) override;
         llvm::Value *getAssignPtr(CodegenContext &context) override;
-        const std::string getSymbolName() override { return this->name; }
+        const std::string getSymbolName() override { return this->name.str(); }
+        TypeNode *getTypeNode(CodegenContext &context) override;
         // void print() override;
     };
 
@@ -12,38 +12,45 @@ namespace spc
     class RoutineHeadNode: public BaseNode
     {
     private:
-        std::shared_ptr<ConstDeclList> constList;
-        std::shared_ptr<VarDeclList> varList;
-        std::shared_ptr<TypeDeclList> typeList;
-        std::shared_ptr<RoutineList> subroutineList;
+        ConstDeclList *constList;
+        VarDeclList *varList;
+        TypeDeclList *typeList;
+        RoutineList *subroutineList;
     public:
         RoutineHeadNode(
-            const std::shared_ptr<ConstDeclList> &constList,
-            const std::shared_ptr<VarDeclList> &varList,
-            const std::shared_ptr<TypeDeclList> &typeList,
-            const std::shared_ptr<RoutineList> &subroutineList
+            ConstDeclList *constList,
+            VarDeclList *varList,
+            TypeDeclList *typeList,
+            RoutineList *subroutineList
             )
-            : constList(constList), varList(varList), typeList(typeList), subroutineList(subroutineList) {}
+            : BaseNode(NodeKind::RoutineHead), constList(constList), varList(varList), typeList(typeList), subroutineList(subroutineList) {}
         ~RoutineHeadNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::RoutineHead; }
 
         llvm::Value *codegen(CodegenContext &) override { return nullptr; }
         // void print() override;
         friend class ASTvis;
         friend class ProgramNode;
         friend class RoutineNode;
+        friend class UnitNode;
         friend class ASTopt;
+        friend class UnitInterface;
     };
 
     class BaseRoutineNode: public BaseNode
     {
     protected:
-        std::shared_ptr<IdentifierNode> name;
-        std::shared_ptr<RoutineHeadNode> header;
-        std::shared_ptr<CompoundStmtNode> body;
+        IdentifierNode *name;
+        RoutineHeadNode *header;
+        CompoundStmtNode *body;
     public:
-        BaseRoutineNode(const std::shared_ptr<IdentifierNode> &name, const std::shared_ptr<RoutineHeadNode> &header, const std::shared_ptr<CompoundStmtNode> &body)
-            : name(name), header(header), body(body) {}
+        BaseRoutineNode(const NodeKind kind, IdentifierNode *name, RoutineHeadNode *header, CompoundStmtNode *body)
+            : BaseNode(kind), name(name), header(header), body(body) {}
         ~BaseRoutineNode() = default;
+        static bool classof(const BaseNode *node) 
+        { 
+            return node->getKind() >= NodeKind::Routine && node->getKind() <= NodeKind::Unit; 
+        }
 
         std::string getName() const { return name->name; }
         llvm::Value *codegen(CodegenContext &) = 0;
@@ -55,34 +62,76 @@ namespace spc
     class RoutineNode: public BaseRoutineNode
     {
     private:
-        std::shared_ptr<ParamList> params;
-        std::shared_ptr<TypeNode> retType;
+        ParamList *params;
+        TypeNode *retType;
+
+        llvm::FunctionType *getFunctionType(CodegenContext &context);
     public:
         RoutineNode(
-            const std::shared_ptr<IdentifierNode> &name, 
-            const std::shared_ptr<RoutineHeadNode> &header, 
-            const std::shared_ptr<CompoundStmtNode> &body, 
-            const std::shared_ptr<ParamList> &params, 
-            const std::shared_ptr<TypeNode> &retType
+            IdentifierNode *name, 
+            RoutineHeadNode *header, 
+            CompoundStmtNode *body, 
+            ParamList *params, 
+            TypeNode *retType
             )
-            : BaseRoutineNode(name, header, body), params(params), retType(retType) {}
+            : BaseRoutineNode(NodeKind::Routine, name, header, body), params(params), retType(retType) {}
         ~RoutineNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Routine; }
 
+        // Generates the definition; header and body are null for a heading in a unit interface
         llvm::Value *codegen(CodegenContext &) override;
+        // Declares the function without a body, or returns the declaration made before
+        llvm::Function *declare(CodegenContext &context);
         // void print() override;
         friend class ASTvis;
+        friend class UnitInterface;
     };
 
     class ProgramNode: public BaseRoutineNode
     {
+    private:
+        IdentifierList *uses;
     public:
-        using BaseRoutineNode::BaseRoutineNode;
+        ProgramNode(IdentifierNode *name, IdentifierList *uses, RoutineHeadNode *header, CompoundStmtNode *body)
+            : BaseRoutineNode(NodeKind::Program, name, header, body), uses(uses) {}
         ~ProgramNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Program; }
+
+        IdentifierList *getUses() const { return uses; }
+        llvm::Value *codegen(CodegenContext &) override;
+        // void print() override;
+        friend class ASTvis;
+    };
+
+    // unit <name>; interface ... implementation ... end.
+    // Compiles to a module without main. Its interface is written to an interface file
+    // (see UnitInterface) that the uses clauses of other programs and units load.
+    class UnitNode: public BaseRoutineNode
+    {
+    private:
+        // Units the interface needs, also loaded by every user of this one
+        IdentifierList *interfaceUses;
+        // consts, types and vars visible to users, and headings of the routines they may call
+        RoutineHeadNode *interfaceHead;
+        IdentifierList *implementationUses;
+    public:
+        // header is the implementation part; a unit has no body
+        UnitNode(IdentifierNode *name, IdentifierList *interfaceUses, RoutineHeadNode *interfaceHead, IdentifierList *implementationUses, RoutineHeadNode *header)
+            : BaseRoutineNode(NodeKind::Unit, name, header, make_node<CompoundStmtNode>()),
+              interfaceUses(interfaceUses), interfaceHead(interfaceHead), implementationUses(implementationUses) {}
+        ~UnitNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Unit; }
 
+        IdentifierList *getInterfaceUses() const { return interfaceUses; }
+        IdentifierList *getImplementationUses() const { return implementationUses; }
         llvm::Value *codegen(CodegenContext &) override;
+        // Adds the interface to the global scope. The unit being compiled defines its vars and
+        // string consts; a unit loaded by a uses clause only declares them, they live in its object.
+        void declareInterface(CodegenContext &context, bool imported);
         // void print() override;
         friend class ASTvis;
-    };   
+        friend class UnitInterface;
+    };
 
 } // namespace spc
 
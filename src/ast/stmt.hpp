@@ -11,17 +11,18 @@ namespace spc
     class IfStmtNode: public StmtNode
     {
     private:
-        std::shared_ptr<ExprNode> expr;
-        std::shared_ptr<CompoundStmtNode> if_stmt;
-        std::shared_ptr<CompoundStmtNode> else_stmt;
+        ExprNode *expr;
+        CompoundStmtNode *if_stmt;
+        CompoundStmtNode *else_stmt;
     public:
         IfStmtNode(
-            const std::shared_ptr<ExprNode> &expr, 
-            const std::shared_ptr<CompoundStmtNode> &if_stmt, 
-            const std::shared_ptr<CompoundStmtNode> &else_stmt = nullptr
+            ExprNode *expr, 
+            CompoundStmtNode *if_stmt, 
+            CompoundStmtNode *else_stmt = nullptr
             ) 
-            : expr(expr), if_stmt(if_stmt), else_stmt(else_stmt) {}
+            : StmtNode(NodeKind::IfStmt), expr(expr), if_stmt(if_stmt), else_stmt(else_stmt) {}
         ~IfStmtNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::IfStmt; }
 
         llvm::Value *codegen(CodegenContext &context) override;
         // void print() override;
@@ -32,15 +33,16 @@ namespace spc
     class WhileStmtNode: public StmtNode
     {
     private:
-        std::shared_ptr<ExprNode> expr;
-        std::shared_ptr<CompoundStmtNode> stmt;
+        ExprNode *expr;
+        CompoundStmtNode *stmt;
     public:
         WhileStmtNode(
-            const std::shared_ptr<ExprNode> &expr, 
-            const std::shared_ptr<CompoundStmtNode> &stmt
+            ExprNode *expr, 
+            CompoundStmtNode *stmt
             )
-            : expr(expr), stmt(stmt) {}
+            : StmtNode(NodeKind::WhileStmt), expr(expr), stmt(stmt) {}
         ~WhileStmtNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::WhileStmt; }
 
         llvm::Value *codegen(CodegenContext &context) override;
         // void print() override;
@@ -55,20 +57,21 @@ namespace spc
     {
     private:
         ForDirection direction;
-        std::shared_ptr<IdentifierNode> id;
-        std::shared_ptr<ExprNode> init_val;
-        std::shared_ptr<ExprNode> end_val;
-        std::shared_ptr<CompoundStmtNode> stmt;
+        IdentifierNode *id;
+        ExprNode *init_val;
+        ExprNode *end_val;
+        CompoundStmtNode *stmt;
     public:
         ForStmtNode(
             const ForDirection dir,
-            const std::shared_ptr<IdentifierNode> &id, 
-            const std::shared_ptr<ExprNode> &init_val, 
-            const std::shared_ptr<ExprNode> &end_val, 
-            const std::shared_ptr<CompoundStmtNode> &stmt
+            IdentifierNode *id, 
+            ExprNode *init_val, 
+            ExprNode *end_val, 
+            CompoundStmtNode *stmt
             )
-            : direction(dir), id(id), init_val(init_val), end_val(end_val), stmt(stmt) {}
+            : StmtNode(NodeKind::ForStmt), direction(dir), id(id), init_val(init_val), end_val(end_val), stmt(stmt) {}
         ~ForStmtNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::ForStmt; }
 
         llvm::Value *codegen(CodegenContext &context) override;
         // void print() override;
@@ -78,15 +81,16 @@ namespace spc
     class RepeatStmtNode: public StmtNode
     {
     private:
-        std::shared_ptr<ExprNode> expr;
-        std::shared_ptr<CompoundStmtNode> stmt;
+        ExprNode *expr;
+        CompoundStmtNode *stmt;
     public:
         RepeatStmtNode(
-            const std::shared_ptr<ExprNode> &expr, 
-            const std::shared_ptr<CompoundStmtNode> &stmt
+            ExprNode *expr, 
+            CompoundStmtNode *stmt
             )
-            : expr(expr), stmt(stmt) {}
+            : StmtNode(NodeKind::RepeatStmt), expr(expr), stmt(stmt) {}
         ~RepeatStmtNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::RepeatStmt; }
 
         llvm::Value *codegen(CodegenContext &context) override;
         // void print() override;
@@ -97,10 +101,11 @@ namespace spc
     class ProcStmtNode: public StmtNode
     {
     private:
-        std::shared_ptr<ProcNode> call;
+        ProcNode *call;
     public:
-        ProcStmtNode(const std::shared_ptr<ProcNode> &call) : call(call) {}
+        ProcStmtNode(ProcNode *call) : StmtNode(NodeKind::ProcStmt), call(call) {}
         ~ProcStmtNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::ProcStmt; }
         llvm::Value *codegen(CodegenContext &context) override;
         // void print() override;
         friend class ASTvis;
@@ -109,13 +114,14 @@ namespace spc
     class AssignStmtNode: public StmtNode
     {
     private:
-        std::shared_ptr<LeftExprNode> lhs;
-        std::shared_ptr<ExprNode> rhs;
+        LeftExprNode *lhs;
+        ExprNode *rhs;
     public:
-        AssignStmtNode(const std::shared_ptr<LeftExprNode> &lhs, const std::shared_ptr<ExprNode> &rhs)
-            : lhs(lhs), rhs(rhs)
+        AssignStmtNode(LeftExprNode *lhs, ExprNode *rhs)
+            : StmtNode(NodeKind::AssignStmt), lhs(lhs), rhs(rhs)
         {}
         ~AssignStmtNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::AssignStmt; }
 
         llvm::Value *codegen(CodegenContext &context) override;
         // void print() override;
@@ -128,12 +134,13 @@ namespace spc
     class CaseBranchNode: public StmtNode
     {
     private:
-        std::shared_ptr<ExprNode> branch;
-        std::shared_ptr<CompoundStmtNode> stmt;
+        ExprNode *branch;
+        CompoundStmtNode *stmt;
     public:
-        CaseBranchNode(const std::shared_ptr<ExprNode> &branch, const std::shared_ptr<CompoundStmtNode> &stmt)
-            : branch(branch), stmt(stmt) {}
+        CaseBranchNode(ExprNode *branch, CompoundStmtNode *stmt)
+            : StmtNode(NodeKind::CaseBranch), branch(branch), stmt(stmt) {}
         ~CaseBranchNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::CaseBranch; }
 
         llvm::Value *codegen(CodegenContext &context) override { return nullptr; }
         // void print() override;
@@ -146,14 +153,13 @@ namespace spc
     class CaseStmtNode: public StmtNode
     {
     private:
-        std::shared_ptr<ExprNode> expr;
-        std::list<std::shared_ptr<CaseBranchNode>> branches;
+        ExprNode *expr;
+        std::list<CaseBranchNode *> branches;
     public:
-        CaseStmtNode(const std::shared_ptr<ExprNode> &expr, const std::shared_ptr<CaseBranchList> &list)
-            : expr(expr), branches(list->getChildren()) {}
-        CaseStmtNode(const std::shared_ptr<ExprNode> &expr, std::shared_ptr<CaseBranchList> &&list)
-            : expr(expr), branches(std::move(list->getChildren())) {}
+        CaseStmtNode(ExprNode *expr, CaseBranchList *list)
+            : StmtNode(NodeKind::CaseStmt), expr(expr), branches(std::move(list->getChildren())) {}
         ~CaseStmtNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::CaseStmt; }
 
         llvm::Value *codegen(CodegenContext &context) override;
         // void print() override;
@@ -0,0 +1,88 @@
+#ifndef SYMBOL_AST
+#define SYMBOL_AST
+
+#include <llvm/ADT/DenseMapInfo.h>
+#include <llvm/ADT/None.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Allocator.h>
+
+#include <cctype>
+#include <functional>
+
+namespace spc
+{
+    // Handle to an interned, lower-cased identifier: the pool entry whose key is the spelling.
+    // Two symbols of the same pool compare equal iff they spell the same name, so equality is a
+    // pointer compare.
+    class Symbol
+    {
+    public:
+        using Entry = llvm::StringMapEntry<llvm::NoneType>;
+    private:
+        const Entry *entry = nullptr;
+    public:
+        Symbol() = default;
+        explicit Symbol(const Entry *entry) : entry(entry) {}
+
+        // NUL-terminated, and alive as long as the pool
+        llvm::StringRef str() const { return entry->getKey(); }
+        bool empty() const { return entry == nullptr; }
+        const Entry *getEntry() const { return entry; }
+
+        bool operator==(Symbol rhs) const { return entry == rhs.entry; }
+        bool operator!=(Symbol rhs) const { return entry != rhs.entry; }
+        bool operator<(Symbol rhs) const { return std::less<const Entry *>()(entry, rhs.entry); }
+        size_t hash() const { return std::hash<const Entry *>()(entry); }
+    };
+
+    // One spelling per distinct name of a compilation. Pascal is case-insensitive,
+    // so names are folded once here and never again downstream.
+    class SymbolPool
+    {
+    private:
+        llvm::StringMap<llvm::NoneType, llvm::BumpPtrAllocator &> pool;
+    public:
+        explicit SymbolPool(llvm::BumpPtrAllocator &allocator) : pool(allocator) {}
+        SymbolPool(const SymbolPool &) = delete;
+        SymbolPool &operator=(const SymbolPool &) = delete;
+
+        Symbol intern(llvm::StringRef name)
+        {
+            llvm::SmallString<32> folded;
+            folded.reserve(name.size());
+            for (char c : name)
+                folded.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+            return Symbol(&*pool.try_emplace(folded.str()).first);
+        }
+
+        size_t size() const { return pool.size(); }
+    };
+
+} // namespace spc
+
+namespace std
+{
+    template<>
+    struct hash<spc::Symbol>
+    {
+        size_t operator()(spc::Symbol s) const { return s.hash(); }
+    };
+} // namespace std
+
+namespace llvm
+{
+    // Lets symbols key a DenseMap
+    template<>
+    struct DenseMapInfo<spc::Symbol>
+    {
+        using EntryInfo = DenseMapInfo<const spc::Symbol::Entry *>;
+        static spc::Symbol getEmptyKey() { return spc::Symbol(EntryInfo::getEmptyKey()); }
+        static spc::Symbol getTombstoneKey() { return spc::Symbol(EntryInfo::getTombstoneKey()); }
+        static unsigned getHashValue(spc::Symbol s) { return EntryInfo::getHashValue(s.getEntry()); }
+        static bool isEqual(spc::Symbol lhs, spc::Symbol rhs) { return lhs == rhs; }
+    };
+} // namespace llvm
+
+#endif
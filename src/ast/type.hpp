@@ -5,7 +5,8 @@
 #include "identifier.hpp"
 #include <string>
 #include <vector>
-#include <set>
+#include <unordered_map>
+#include <utility>
 
 namespace spc
 {
@@ -16,18 +17,25 @@ namespace spc
     {
     public:
         Type type;
-        TypeNode(const Type type = Unknown) : type(type) {}
+        TypeNode(const NodeKind kind, const Type type) : BaseNode(kind), type(type) {}
         ~TypeNode() {}
+        static bool classof(const BaseNode *node) 
+        { 
+            return node->getKind() >= NodeKind::VoidType && node->getKind() <= NodeKind::ArrayType; 
+        }
         llvm::Value *codegen(CodegenContext &) override { return nullptr; };
         virtual llvm::Type *getLLVMType(CodegenContext &) = 0;
+        // The type with aliases looked through
+        virtual TypeNode *resolve(CodegenContext &) { return this; }
         // void print() override;
     };
 
     class VoidTypeNode: public TypeNode
     {
     public:
-        VoidTypeNode() : TypeNode(Type::Void) {}
+        VoidTypeNode() : TypeNode(NodeKind::VoidType, Type::Void) {}
         ~VoidTypeNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::VoidType; }
         llvm::Type *getLLVMType(CodegenContext &context) override ;
         // void print() override;
     };
@@ -35,8 +43,9 @@ namespace spc
     class SimpleTypeNode: public TypeNode
     {
     public:
-        SimpleTypeNode(const Type type) : TypeNode(type) {}
+        SimpleTypeNode(const Type type) : TypeNode(NodeKind::SimpleType, type) {}
         ~SimpleTypeNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::SimpleType; }
         llvm::Type *getLLVMType(CodegenContext &) override;
         // void print() override;
     };
@@ -44,20 +53,28 @@ namespace spc
     class StringTypeNode: public TypeNode
     {
     public:
-        StringTypeNode() : TypeNode(Type::String) {}
+        StringTypeNode() : TypeNode(NodeKind::StringType, Type::String) {}
         ~StringTypeNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::StringType; }
         llvm::Type *getLLVMType(CodegenContext &context) override;
         // void print() override;
     };
 
     class AliasTypeNode: public TypeNode
     {
+    private:
+        // The alias is looked up once, in the scope of its first use
+        llvm::Type *llvmType = nullptr;
+        // The array or record type it names, if any
+        TypeNode *target = nullptr;
     public:
-        std::shared_ptr<IdentifierNode> name;
-        AliasTypeNode(const std::shared_ptr<IdentifierNode> &name)
-            : TypeNode(Type::Alias), name(name) {}
+        IdentifierNode *name;
+        AliasTypeNode(IdentifierNode *name)
+            : TypeNode(NodeKind::AliasType, Type::Alias), name(name) {}
         ~AliasTypeNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::AliasType; }
         llvm::Type *getLLVMType(CodegenContext &context) override;
+        TypeNode *resolve(CodegenContext &context) override;
         // void print() override;
     };
 
@@ -68,26 +85,31 @@ namespace spc
     {
         
     private:
-        std::list<std::shared_ptr<VarDeclNode>> field;
+        std::vector<VarDeclNode *> field;
+        // Field name to its index in the struct, kept in step with field
+        std::unordered_map<Symbol, unsigned> fieldIdx;
+        llvm::StructType *llvmType = nullptr;
     public:
-        RecordTypeNode(const std::shared_ptr<IdentifierList> &names, const std::shared_ptr<TypeNode> &type)
-            : TypeNode(Type::Record)
+        RecordTypeNode(IdentifierList *names, TypeNode *type)
+            : TypeNode(NodeKind::RecordType, Type::Record)
         {
             for (auto &id : names->getChildren())
             {
-                field.push_back(make_node<VarDeclNode>(id, type));
+                append(make_node<VarDeclNode>(id, type));
             }
         }
         ~RecordTypeNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::RecordType; }
         
-        void append(const std::shared_ptr<VarDeclNode> &var);
-        void merge(const std::shared_ptr<RecordTypeNode> &rhs);
-        void merge(std::shared_ptr<RecordTypeNode> &&rhs);
+        void append(VarDeclNode *var);
+        void merge(RecordTypeNode *rhs);
         llvm::Type *getLLVMType(CodegenContext &context) override;
-        llvm::Value *getFieldIdx(const std::string &name, CodegenContext &context);
-        void insertNestedRecord(const std::string &outer, CodegenContext &context);
+        llvm::Value *getFieldIdx(Symbol name, CodegenContext &context);
+        // Declared type of a field, nullptr if there is no such field
+        TypeNode *getFieldType(Symbol name);
         // void print() override;
         friend class CodegenContext;
+        friend class UnitInterface;
     };
     
 
@@ -95,8 +117,12 @@ namespace spc
     {
     public:
         Type type;
-        ConstValueNode(const Type type = Type::Unknown): type(type) {}
+        ConstValueNode(const NodeKind kind, const Type type): ExprNode(kind), type(type) {}
         ~ConstValueNode() = default;
+        static bool classof(const BaseNode *node) 
+        { 
+            return node->getKind() >= NodeKind::Boolean && node->getKind() <= NodeKind::String; 
+        }
 
         llvm::Type *getLLVMType(CodegenContext &context);
     };
@@ -105,8 +131,9 @@ namespace spc
     {
     public:
         bool val;
-        BooleanNode(const bool val = false): ConstValueNode(Type::Bool), val(val) {}
+        BooleanNode(const bool val = false): ConstValueNode(NodeKind::Boolean, Type::Bool), val(val) {}
         ~BooleanNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Boolean; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
@@ -116,8 +143,9 @@ namespace spc
     {
     public:
         int val;
-        IntegerNode(const int val = 0): ConstValueNode(Type::Int), val(val) {}
+        IntegerNode(const int val = 0): ConstValueNode(NodeKind::Integer, Type::Int), val(val) {}
         ~IntegerNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Integer; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
@@ -127,8 +155,9 @@ namespace spc
     {
     public:
         double val;
-        RealNode(const double val = 0.0): ConstValueNode(Type::Real), val(val) {}
+        RealNode(const double val = 0.0): ConstValueNode(NodeKind::Real, Type::Real), val(val) {}
         ~RealNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Real; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
@@ -138,8 +167,9 @@ namespace spc
     {
     public:
         char val;
-        CharNode(const char val = '\0'): ConstValueNode(Type::Char), val(val) {}
+        CharNode(const char val = '\0'): ConstValueNode(NodeKind::Char, Type::Char), val(val) {}
         ~CharNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::Char; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
@@ -149,9 +179,10 @@ namespace spc
     {
     public:
         std::string val;
-        StringNode(const char *val = ""): ConstValueNode(Type::String), val(val) {}
-        StringNode(const std::string &val): ConstValueNode(Type::String), val(val) {}
+        StringNode(const char *val = ""): ConstValueNode(NodeKind::String, Type::String), val(val) {}
+        StringNode(const std::string &val): ConstValueNode(NodeKind::String, Type::String), val(val) {}
         ~StringNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::String; }
 
         llvm::Value *codegen(CodegenContext &) override;
         // void print() override;
@@ -159,27 +190,33 @@ namespace spc
     
     class ArrayTypeNode: public TypeNode
     {
+    private:
+        llvm::ArrayType *llvmType = nullptr;
+        bool hasRange = false;
+        std::pair<int, int> range;
     public:
-        std::shared_ptr<ExprNode> range_start;
-        std::shared_ptr<ExprNode> range_end;
-        std::shared_ptr<TypeNode> itemType;
+        ExprNode *range_start;
+        ExprNode *range_end;
+        TypeNode *itemType;
 
         ArrayTypeNode(
-            const std::shared_ptr<ExprNode> &start,
-            const std::shared_ptr<ExprNode> &end,
-            const std::shared_ptr<TypeNode> &itype
-        ) : TypeNode(Type::Array), range_start(start), range_end(end), itemType(itype) {}
+            ExprNode *start,
+            ExprNode *end,
+            TypeNode *itype
+        ) : TypeNode(NodeKind::ArrayType, Type::Array), range_start(start), range_end(end), itemType(itype) {}
         ArrayTypeNode(
             int start,
             int end,
             Type itype
-        ) : TypeNode(Type::Array), 
+        ) : TypeNode(NodeKind::ArrayType, Type::Array), 
             range_start(cast_node<ExprNode>(make_node<IntegerNode>(start))), range_end(cast_node<ExprNode>(make_node<IntegerNode>(end))),
             itemType(make_node<SimpleTypeNode>(itype))
         {}
         ~ArrayTypeNode() = default;
+        static bool classof(const BaseNode *node) { return node->getKind() == NodeKind::ArrayType; }
         llvm::Type *getLLVMType(CodegenContext &) override;
-        void insertNestedArray(const std::string &outer, CodegenContext &context);
+        // Index bounds, evaluated once
+        const std::pair<int, int> &getRange(CodegenContext &context);
         // void print() override;
     };
     
@@ -1,15 +1,19 @@
 #ifndef CODEGEN_CONTEXT_H
 #define CODEGEN_CONTEXT_H
 #include "utils/ast.hpp"
+#include "utils/report.hpp"
 
 #include <string>
 #include <fstream>
 #include <list>
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
 #include <iomanip>
 
-static llvm::LLVMContext llvm_context;
-
 namespace spc
 {
     class ArrayTypeNode;
@@ -31,37 +35,129 @@ namespace spc
     private:
         std::unique_ptr<llvm::Module> _module;
         llvm::IRBuilder<> builder;
-        std::map<std::string, llvm::Type *> aliases;
-        std::map<std::string, std::shared_ptr<ArrayTypeNode>> arrAliases;
-        std::map<std::string, std::shared_ptr<std::pair<int, int>>> arrTable;
-        std::map<std::string, std::shared_ptr<RecordTypeNode>> recAliases;
-        std::map<std::string, llvm::Value*> locals;
-        std::map<std::string, llvm::Value*> consts;
-        std::map<std::string, llvm::Constant*> constVals;
-        std::ofstream of;
+    public:
+        // Symbols declared by one routine; the scope of the main program holds the globals.
+        // Tables are keyed by the interned symbol, so a lookup hashes a pointer, not the name.
+        struct Scope
+        {
+            std::string name;
+            llvm::DenseMap<Symbol, llvm::Type *> aliases;
+            llvm::DenseMap<Symbol, ArrayTypeNode *> arrAliases;
+            llvm::DenseMap<Symbol, RecordTypeNode *> recAliases;
+            llvm::DenseMap<Symbol, llvm::Value *> locals;
+            // Declared type of variables, params and return values, aliases resolved
+            llvm::DenseMap<Symbol, TypeNode *> varTypes;
+            // const params and consts; string consts map to their global variable
+            llvm::DenseMap<Symbol, llvm::Value *> consts;
+            llvm::DenseMap<Symbol, llvm::Constant *> constVals;
+            // Locals and value params that hold strings, released when the routine returns
+            std::vector<llvm::Value *> finalize;
+
+            explicit Scope(const std::string &name) : name(name) {}
+        };
 
-        void createTempStr()
+    private:
+        // Every scope opened so far, the global one first. Scopes stay alive after their routine
+        // is generated so that -print-table can list them.
+        std::list<Scope> scopes;
+        // Scopes of the routines being generated, innermost last
+        std::vector<Scope *> scopeStack;
+        std::ofstream of;
+        // spc_str of the runtime: {refs, len, cap, [0 x i8] data}
+        llvm::StructType *strTy;
+        llvm::StringMap<llvm::Constant *> strLiterals;
+        // #0, read in place of a char beyond the end of a string
+        llvm::GlobalVariable *strNulChar = nullptr;
+        // Strings returned by calls in the statement being generated, owned by the statement
+        std::vector<llvm::Value *> temporaries;
+
+        // Searches the scope stack from the innermost scope outwards
+        template <typename V>
+        V *find(llvm::DenseMap<Symbol, V> Scope::*table, Symbol name)
+        {
+            for (auto rit = scopeStack.rbegin(); rit != scopeStack.rend(); rit++)
+            {
+                auto &map = (*rit)->*table;
+                auto it = map.find(name);
+                if (it != map.end())
+                    return &it->second;
+            }
+            return nullptr;
+        }
+        template <typename V>
+        bool insert(llvm::DenseMap<Symbol, V> Scope::*table, Symbol name, const V &value)
         {
-            auto *ty = llvm::Type::getInt8Ty(llvm_context);
-            llvm::Constant *z = llvm::ConstantInt::get(ty, 0);
-            llvm::ArrayType* arr = llvm::ArrayType::get(ty, 256);
-            std::vector<llvm::Constant *> initVector;
-            for (int i = 0; i < 256; i++)
-                initVector.push_back(z);
-            auto *variable = llvm::ConstantArray::get(arr, initVector);
-
-            // std::cout << "Created array" << std::endl;
+            return (scopeStack.back()->*table).try_emplace(name, value).second;
+        }
+        // Entries of one table sorted by name, so that -print-table output is stable
+        template <typename V>
+        static std::vector<const std::pair<Symbol, V> *> sorted(const llvm::DenseMap<Symbol, V> &map)
+        {
+            std::vector<const std::pair<Symbol, V> *> entries;
+            for (auto &e : map)
+                entries.push_back(&e);
+            std::sort(entries.begin(), entries.end(), [](const std::pair<Symbol, V> *a, const std::pair<Symbol, V> *b) { return a->first.str() < b->first.str(); });
+            return entries;
+        }
 
-            new llvm::GlobalVariable(*_module, variable->getType(), false, llvm::GlobalVariable::ExternalLinkage, variable, "__tmp_str");
+        static bool containsString(llvm::Type *ty)
+        {
+            if (isStringTy(ty))
+                return true;
+            if (ty->isArrayTy())
+                return containsString(ty->getArrayElementType());
+            if (ty->isStructTy())
+                return std::any_of(ty->subtype_begin(), ty->subtype_end(), containsString);
+            return false;
+        }
+        // Emits fn for the address of every string inside the variable at ptr, looping over arrays
+        template <typename F>
+        void forEachString(llvm::Value *ptr, F fn)
+        {
+            auto *ty = ptr->getType()->getPointerElementType();
+            if (isStringTy(ty))
+                fn(ptr);
+            else if (ty->isStructTy())
+            {
+                for (unsigned i = 0; i < ty->getStructNumElements(); i++)
+                    if (containsString(ty->getStructElementType(i)))
+                        forEachString(builder.CreateInBoundsGEP(ptr, {builder.getInt32(0), builder.getInt32(i)}), fn);
+            }
+            else if (ty->isArrayTy() && containsString(ty->getArrayElementType()))
+            {
+                auto *func = builder.GetInsertBlock()->getParent();
+                auto *preheader = builder.GetInsertBlock();
+                auto *body = llvm::BasicBlock::Create(_module->getContext(), "strings", func);
+                auto *cont = llvm::BasicBlock::Create(_module->getContext(), "cont", func);
+                builder.CreateBr(body);
+                builder.SetInsertPoint(body);
+                auto *i = builder.CreatePHI(builder.getInt64Ty(), 2);
+                i->addIncoming(builder.getInt64(0), preheader);
+                forEachString(builder.CreateInBoundsGEP(ptr, {builder.getInt64(0), i}), fn);
+                auto *next = builder.CreateNUWAdd(i, builder.getInt64(1));
+                i->addIncoming(next, builder.GetInsertBlock());
+                builder.CreateCondBr(builder.CreateICmpEQ(next, builder.getInt64(ty->getArrayNumElements())), cont, body);
+                builder.SetInsertPoint(cont);
+            }
         }
 
     public:
         bool is_subroutine;
-        std::list<std::string> traces;
-        llvm::Function *printfFunc, *sprintfFunc, *scanfFunc, *absFunc, *fabsFunc, *sqrtFunc, *strcpyFunc, *strcatFunc, *getcharFunc, *strlenFunc, *atoiFunc;
-
-        std::unique_ptr<llvm::legacy::FunctionPassManager> fpm;
-        std::unique_ptr<llvm::legacy::PassManager> mpm;
+        llvm::Function *absFunc, *fabsFunc, *sqrtFunc, *atoiFunc;
+        // libspcrt, see runtime/spcrt.h
+        llvm::Function *strRetainFunc, *strReleaseFunc, *strAssignFunc, *strAtFunc, *strCStrFunc, *strReadFunc;
+        llvm::Function *strConcatFunc, *strOfIntFunc, *strOfCharFunc, *strOfRealFunc;
+        llvm::Function *writeIntFunc, *writeRealFunc, *writeCharFunc, *writeStrFunc, *flushFunc;
+        llvm::Function *readIntFunc, *readRealFunc, *readCharFunc, *readlnFunc;
+
+        // Set by Compilation when a time/memory report is requested
+        CompileReport *report = nullptr;
+        // Directories searched for the interface files of used units
+        std::vector<std::string> unitPath;
+        // Units whose interface is declared in the module, the unit being compiled included
+        llvm::StringSet<> units;
+        // Routines of the interface of the unit being compiled that are not defined yet
+        llvm::StringSet<> pendingRoutines;
 
         std::ofstream &log() { return of; }
 
@@ -80,13 +176,12 @@ namespace spc
                 if (ty->isIntegerTy(32)) return "Integer/Long";
                 return "Unknown";
             case 15: 
-                if (ty->getPointerElementType()->isIntegerTy(8)) return "String";
-                return "Unknown";
+                if (isStringTy(ty)) return "String";
+                return "Ref " + getLLVMTypeName(ty->getPointerElementType());
             case 3:
                 return "Real";
             case 14:
                 arrTy = ty->getArrayElementType();
-                if (arrTy->isIntegerTy(8)) return "String";
                 return "Array of " + getLLVMTypeName(arrTy);
             case 13:
                 return "Record";
@@ -147,17 +242,11 @@ namespace spc
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             std::cout << '|' << std::setw(19) << std::setfill(' ')  << "Function" << '|' << std::setw(19) << "Name" << '|' << std::setw(38) << "Type" << '|' << std::endl;
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
-            for (auto it = aliases.cbegin(); it != aliases.cend(); it++)
+            for (auto &scope : scopes)
+            for (auto *e : sorted(scope.aliases))
             {
-                std::string c = it->first;
-                int pos = c.find('.');
-                std::string c1;
-                if (pos == -1) c1 = "main";
-                else c1 = c.substr(0, pos);     
-                std::string c2 = c.substr(pos + 1, c.length());
-                llvm::Type *val = it->second;
-                std::string c3 = getLLVMTypeName(val);
-                std::cout << '|' << std::setw(19) << std::setfill(' ')  << c1 << '|' << std::setw(19) << c2 << '|' << std::setw(38) << c3 << '|' << std::endl;
+                std::string c3 = getLLVMTypeName(e->second);
+                std::cout << '|' << std::setw(19) << std::setfill(' ')  << scope.name << '|' << std::setw(19) << e->first.str().str() << '|' << std::setw(38) << c3 << '|' << std::endl;
                 std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             }
         }
@@ -168,40 +257,29 @@ namespace spc
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             std::cout << '|' << std::setw(19) << std::setfill(' ')  << "Function" << '|' << std::setw(19) << "Name" << '|' << std::setw(38) << "Type" << '|' << std::endl;
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
-            for (auto it = arrAliases.cbegin(); it != arrAliases.cend(); it++)
+            for (auto &scope : scopes)
+            for (auto *e : sorted(scope.arrAliases))
             {
-                std::string c = it->first;
-                int pos = c.find('.');
-                std::string c1;
-                if (pos == -1) c1 = "main";
-                else c1 = c.substr(0, pos);    
-                std::string c2 = c.substr(pos + 1, c.length());
-                auto val = it->second;
-
-                auto start = val->range_start->codegen(*this);
-                llvm::ConstantInt *startI = llvm::dyn_cast<llvm::ConstantInt>(start);
-                assert(startI != nullptr);
-                int startInt = startI->getSExtValue();
-
-                auto end = val->range_end->codegen(*this);
-                llvm::ConstantInt *endI = llvm::dyn_cast<llvm::ConstantInt>(end);
-                assert(endI != nullptr);
-                int endInt = endI->getSExtValue();
-
-                if (c1 != "main") 
+                auto val = e->second;
+
+                auto &range = val->getRange(*this);
+                int startInt = range.first, endInt = range.second;
+
+                // resolve the item type in the scope the alias was declared in
+                bool global = &scope == &scopes.front();
+                if (!global) 
                 {
                     this->is_subroutine = true;
-                    this->traces.push_back(c1);
+                    this->scopeStack.push_back(&scope);
                 }
                 std::string type = getLLVMTypeName(val->itemType->getLLVMType(*this));
-                if (c1 != "main")
+                if (!global)
                 {
-                    this->traces.pop_back();
+                    this->scopeStack.pop_back();
                     this->is_subroutine = false;
                 }
-                std::string info = "[" + std::to_string(startInt) + ", " + std::to_string(endInt) + "] of " + type;
-
-                std::cout << '|' << std::setw(19) << std::setfill(' ')  << c1 << '|' << std::setw(19) << c2 << '|' << std::setw(38) << info << '|' << std::endl;
+                std::string c3 = "[" + std::to_string(startInt) + ", " + std::to_string(endInt) + "] of " + type;
+                std::cout << '|' << std::setw(19) << std::setfill(' ')  << scope.name << '|' << std::setw(19) << e->first.str().str() << '|' << std::setw(38) << c3 << '|' << std::endl;
                 std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             }
         }
@@ -212,17 +290,14 @@ namespace spc
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             std::cout << '|' << std::setw(19) << std::setfill(' ')  << "Function" << '|' << std::setw(19) << "Name" << '|' << std::setw(38) << "Type" << '|' << std::endl;
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
-            for (auto it = arrTable.cbegin(); it != arrTable.cend(); it++)
+            for (auto &scope : scopes)
+            for (auto *e : sorted(scope.varTypes))
             {
-                std::string c = it->first;
-                int pos = c.find('.');
-                std::string c1;
-                if (pos == -1) c1 = "main";
-                else c1 = c.substr(0, pos);
-                std::string c2 = c.substr(pos + 1, c.length());
-                auto val = it->second;
-                std::string c3 = "[" + std::to_string((*val).first) + ", " + std::to_string((*val).second) + "]";
-                std::cout << '|' << std::setw(19) << std::setfill(' ')  << c1 << '|' << std::setw(19) << c2 << '|' << std::setw(38) << c3 << '|' << std::endl;
+                if (!is_ptr_of<ArrayTypeNode>(e->second))
+                    continue;
+                auto &val = cast_node<ArrayTypeNode>(e->second)->getRange(*this);
+                std::string c3 = "[" + std::to_string(val.first) + ", " + std::to_string(val.second) + "]";
+                std::cout << '|' << std::setw(19) << std::setfill(' ')  << scope.name << '|' << std::setw(19) << e->first.str().str() << '|' << std::setw(38) << c3 << '|' << std::endl;
                 std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             }
         }
@@ -233,19 +308,15 @@ namespace spc
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(69) << '+' << '+' << std::endl;
             std::cout << '|' << std::setw(19) << std::setfill(' ')  << "Function" << '|' << std::setw(19) << "Name" << '|' << std::setw(68) << "Members" << '|' << std::endl;
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(69) << '+' << '+' << std::endl;
-            for (auto it = recAliases.cbegin(); it != recAliases.cend(); it++)
+            for (auto &scope : scopes)
+            for (auto *e : sorted(scope.recAliases))
             {
-                std::string c = it->first;
-                int pos = c.find('.');
-                std::string c1;
-                if (pos == -1) c1 = "main";
-                else c1 = c.substr(0, pos);      
-                std::string c2 = c.substr(pos + 1, c.length());
-                auto val = it->second;
-                if (c1 != "main") 
+                auto val = e->second;
+                bool global = &scope == &scopes.front();
+                if (!global) 
                 {
                     this->is_subroutine = true;
-                    this->traces.push_back(c1);
+                    this->scopeStack.push_back(&scope);
                 }
                 std::string type = getLLVMTypeName(val->getLLVMType(*this));
                 std::string info = type + "{";
@@ -257,13 +328,13 @@ namespace spc
                     else info = info + ", " + n + ": " + t;
                 }
                 info = info + "}";
-                if (c1 != "main")
+                if (!global)
                 {
-                    this->traces.pop_back();
+                    this->scopeStack.pop_back();
                     this->is_subroutine = false;
                 }
 
-                std::cout << '|' << std::setw(19) << std::setfill(' ')  << c1 << '|' << std::setw(19) << c2 << '|' << std::setw(68) << info << '|' << std::endl;
+                std::cout << '|' << std::setw(19) << std::setfill(' ')  << scope.name << '|' << std::setw(19) << e->first.str().str() << '|' << std::setw(68) << info << '|' << std::endl;
                 std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(69) << '+' << '+' << std::endl;
             }
         }
@@ -274,16 +345,11 @@ namespace spc
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             std::cout << '|' << std::setw(19) << std::setfill(' ')  << "Function" << '|' << std::setw(19) << "Name" << '|' << std::setw(38) << "Type" << '|' << std::endl;
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
-            for (auto it = locals.cbegin(); it != locals.cend(); it++)
+            for (auto &scope : scopes)
+            for (auto *e : sorted(scope.locals))
             {
-                std::string c = it->first;
-                int pos = c.find('.');
-                std::string c1 = c.substr(0, pos);      
-                std::string c2 = c.substr(pos + 1, c.length());
-                llvm::Value *val = it->second;
-                std::string c3 = getLLVMTypeName(val->getType()->getPointerElementType());
-
-                std::cout << '|' << std::setw(19) << std::setfill(' ')  << c1 << '|' << std::setw(19) << c2 << '|' << std::setw(38) << c3 << '|' << std::endl;
+                std::string c3 = getLLVMTypeName(e->second->getType()->getPointerElementType());
+                std::cout << '|' << std::setw(19) << std::setfill(' ')  << scope.name << '|' << std::setw(19) << e->first.str().str() << '|' << std::setw(38) << c3 << '|' << std::endl;
                 std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             }
         }
@@ -294,18 +360,13 @@ namespace spc
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             std::cout << '|' << std::setw(19) << std::setfill(' ')  << "Function" << '|' << std::setw(19) << "Name" << '|' << std::setw(38) << "Type" << '|' << std::endl;
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
-            for (auto it = consts.cbegin(); it != consts.cend(); it++)
+            for (auto &scope : scopes)
+            for (auto *e : sorted(scope.consts))
             {
-                std::string c = it->first;
-                int pos = c.find('.');
-                std::string c1;
-                if (pos == -1) c1 = "main";
-                else c1 = c.substr(0, pos);
-                std::string c2 = c.substr(pos + 1, c.length());
-                llvm::Value *val = it->second;
-                std::string c3 = getLLVMTypeName(val->getType());
-
-                std::cout << '|' << std::setw(19) << std::setfill(' ')  << c1 << '|' << std::setw(19) << c2 << '|' << std::setw(38) << c3 << '|' << std::endl;
+                llvm::Value *val = e->second;
+                auto *gv = llvm::dyn_cast<llvm::GlobalVariable>(val);
+                std::string c3 = getLLVMTypeName(gv != nullptr ? gv->getValueType() : val->getType());
+                std::cout << '|' << std::setw(19) << std::setfill(' ')  << scope.name << '|' << std::setw(19) << e->first.str().str() << '|' << std::setw(38) << c3 << '|' << std::endl;
                 std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(39) << '+' << '+' << std::endl;
             }
         }
@@ -348,38 +409,23 @@ namespace spc
             std::cout << '|' << std::setw(19) << std::setfill(' ')  << "Function" << '|' << std::setw(19) << "Name" << '|' << std::setw(19) << "Type" 
                         << '|' << std::setw(19) << "Value" << '|'  << std::endl;
             std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(20) << '+' << std::setw(20) << '+' << '+' << std::endl;
-            for (auto it = constVals.cbegin(); it != constVals.cend(); it++)
+            for (auto &scope : scopes)
+            for (auto *e : sorted(scope.constVals))
             {
-                std::string c = it->first;
-                int pos = c.find('.');
-                std::string c1;
-                if (pos == -1) c1 = "main";
-                else c1 = c.substr(0, pos);
-                std::string c2 = c.substr(pos + 1, c.length());
-                llvm::Constant *val = it->second;
-
-                std::cout << '|' << std::setw(19) << std::setfill(' ')  << c1 << '|' << std::setw(19) << c2 << '|';
-                printConstant(val);
+                std::cout << '|' << std::setw(19) << std::setfill(' ')  << scope.name << '|' << std::setw(19) << e->first.str().str() << '|';
+                printConstant(e->second);
                 std::cout << std::left << std::setw(20) << std::setfill('-') << '+' << std::setw(20) << '+' << std::setw(20) << '+' << std::setw(20) << '+' << '+' << std::endl;
             }
         }
 
-        CodegenContext(const std::string &module_id, bool opt = false)
-            : builder(llvm::IRBuilder<>(llvm_context)), _module(std::make_unique<llvm::Module>(module_id, llvm_context)), is_subroutine(false), of("compile.log")
+        CodegenContext(const std::string &module_id, llvm::LLVMContext &llvm_context, const std::string &log_file = "compile.log")
+            : builder(llvm::IRBuilder<>(llvm_context)), _module(std::make_unique<llvm::Module>(module_id, llvm_context)), is_subroutine(false), of(log_file)
         {
             if (of.fail())
                 throw CodegenException("Fails to open compile log");
 
-            createTempStr();
-
-            auto printfTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(llvm_context), {llvm::Type::getInt8PtrTy(llvm_context)}, true);
-            printfFunc = llvm::Function::Create(printfTy, llvm::Function::ExternalLinkage, "printf", *_module);
-
-            auto sprintfTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(llvm_context), {llvm::Type::getInt8PtrTy(llvm_context), llvm::Type::getInt8PtrTy(llvm_context)}, true);
-            sprintfFunc = llvm::Function::Create(sprintfTy, llvm::Function::ExternalLinkage, "sprintf", *_module);
-
-            auto scanfTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(llvm_context), {llvm::Type::getInt8PtrTy(llvm_context)}, true);
-            scanfFunc = llvm::Function::Create(scanfTy, llvm::Function::ExternalLinkage, "scanf", *_module);
+            scopes.emplace_back("main");
+            scopeStack.push_back(&scopes.front());
 
             auto absTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(llvm_context), {llvm::Type::getInt32Ty(llvm_context)}, false);
             absFunc = llvm::Function::Create(absTy, llvm::Function::ExternalLinkage, "abs", *_module);
@@ -390,46 +436,42 @@ namespace spc
             auto sqrtTy = llvm::FunctionType::get(llvm::Type::getDoubleTy(llvm_context), {llvm::Type::getDoubleTy(llvm_context)}, false);
             sqrtFunc = llvm::Function::Create(sqrtTy, llvm::Function::ExternalLinkage, "sqrt", *_module);
 
-            auto strcpyTy = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(llvm_context), {llvm::Type::getInt8PtrTy(llvm_context), llvm::Type::getInt8PtrTy(llvm_context)}, false);
-            strcpyFunc = llvm::Function::Create(strcpyTy, llvm::Function::ExternalLinkage, "strcpy", *_module);
-
-            auto strcatTy = llvm::FunctionType::get(llvm::Type::getInt8PtrTy(llvm_context), {llvm::Type::getInt8PtrTy(llvm_context), llvm::Type::getInt8PtrTy(llvm_context)}, false);
-            strcatFunc = llvm::Function::Create(strcatTy, llvm::Function::ExternalLinkage, "strcat", *_module);
-
-            auto strlenTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(llvm_context), {llvm::Type::getInt8PtrTy(llvm_context)}, false);
-            strlenFunc = llvm::Function::Create(strlenTy, llvm::Function::ExternalLinkage, "strlen", *_module);
-
             auto atoiTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(llvm_context), {llvm::Type::getInt8PtrTy(llvm_context)}, false);
             atoiFunc = llvm::Function::Create(atoiTy, llvm::Function::ExternalLinkage, "atoi", *_module);
 
-            auto getcharTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(llvm_context), false);
-            getcharFunc = llvm::Function::Create(getcharTy, llvm::Function::ExternalLinkage, "getchar", *_module);
-
-            printfFunc->setCallingConv(llvm::CallingConv::C);
-            sprintfFunc->setCallingConv(llvm::CallingConv::C);
-            scanfFunc->setCallingConv(llvm::CallingConv::C);
             absFunc->setCallingConv(llvm::CallingConv::C);
             fabsFunc->setCallingConv(llvm::CallingConv::C);
             sqrtFunc->setCallingConv(llvm::CallingConv::C);
-            strcpyFunc->setCallingConv(llvm::CallingConv::C);
-            strcatFunc->setCallingConv(llvm::CallingConv::C);
-            strlenFunc->setCallingConv(llvm::CallingConv::C);
             atoiFunc->setCallingConv(llvm::CallingConv::C);
-            getcharFunc->setCallingConv(llvm::CallingConv::C);
 
-            if (opt)
-            {
-                fpm = std::make_unique<llvm::legacy::FunctionPassManager>(_module.get());
-                fpm->add(llvm::createPromoteMemoryToRegisterPass());
-                fpm->add(llvm::createInstructionCombiningPass());
-                fpm->add(llvm::createReassociatePass());
-                fpm->add(llvm::createGVNPass());
-                fpm->add(llvm::createCFGSimplificationPass());
-                fpm->doInitialization();
-                mpm = std::make_unique<llvm::legacy::PassManager>();
-                mpm->add(llvm::createConstantMergePass());
-                mpm->add(llvm::createFunctionInliningPass());
-            }
+            auto *i8PtrTy = llvm::Type::getInt8PtrTy(llvm_context);
+            auto *i32Ty = llvm::Type::getInt32Ty(llvm_context);
+            auto *voidTy = llvm::Type::getVoidTy(llvm_context);
+            strTy = llvm::StructType::get(llvm_context, {i32Ty, i32Ty, i32Ty, llvm::ArrayType::get(llvm::Type::getInt8Ty(llvm_context), 0)});
+            auto *strPtrTy = strTy->getPointerTo();
+            auto declare = [&](llvm::Type *ret, llvm::ArrayRef<llvm::Type *> params, const char *name) {
+                return llvm::Function::Create(llvm::FunctionType::get(ret, params, false), llvm::Function::ExternalLinkage, name, *_module);
+            };
+            strRetainFunc = declare(voidTy, {strPtrTy}, "spc_str_retain");
+            strReleaseFunc = declare(voidTy, {strPtrTy}, "spc_str_release");
+            strAssignFunc = declare(voidTy, {strPtrTy->getPointerTo(), strPtrTy}, "spc_str_assign");
+            strAtFunc = declare(i8PtrTy, {strPtrTy->getPointerTo(), i32Ty}, "spc_str_at");
+            strCStrFunc = declare(i8PtrTy, {strPtrTy}, "spc_str_cstr");
+            strReadFunc = declare(voidTy, {strPtrTy->getPointerTo(), i32Ty}, "spc_str_read");
+            strConcatFunc = declare(strPtrTy, {strPtrTy->getPointerTo(), i32Ty}, "spc_str_concat");
+            strOfIntFunc = declare(strPtrTy, {i32Ty}, "spc_str_of_int");
+            strOfCharFunc = declare(strPtrTy, {llvm::Type::getInt8Ty(llvm_context)}, "spc_str_of_char");
+            strOfRealFunc = declare(strPtrTy, {llvm::Type::getDoubleTy(llvm_context)}, "spc_str_of_real");
+            strCStrFunc->setOnlyReadsMemory();
+            writeIntFunc = declare(voidTy, {i32Ty, i32Ty}, "spc_write_int");
+            writeRealFunc = declare(voidTy, {llvm::Type::getDoubleTy(llvm_context), i32Ty, i32Ty}, "spc_write_real");
+            writeCharFunc = declare(voidTy, {llvm::Type::getInt8Ty(llvm_context), i32Ty}, "spc_write_char");
+            writeStrFunc = declare(voidTy, {strPtrTy, i32Ty}, "spc_write_str");
+            flushFunc = declare(voidTy, {}, "spc_flush");
+            readIntFunc = declare(voidTy, {i32Ty->getPointerTo()}, "spc_read_int");
+            readRealFunc = declare(voidTy, {llvm::Type::getDoubleTy(llvm_context)->getPointerTo()}, "spc_read_real");
+            readCharFunc = declare(voidTy, {i8PtrTy}, "spc_read_char");
+            readlnFunc = declare(voidTy, {}, "spc_readln");
 
             // std::cout << builder.getInt32Ty()->getTypeID() << std::endl;
             // std::cout << builder.getInt8Ty()->getTypeID() << std::endl;
@@ -445,152 +487,247 @@ namespace spc
             if (of.is_open()) of.close();
         }
 
-        llvm::Value *getTempStrPtr()
+        // Strings are pointers to the spc_str of the runtime, the null pointer being the empty string
+        llvm::PointerType *getStringTy()
+        {
+            return strTy->getPointerTo();
+        }
+        static bool isStringTy(const llvm::Type *ty)
+        {
+            // no record has a zero-length array field
+            if (!ty->isPointerTy() || !ty->getPointerElementType()->isStructTy())
+                return false;
+            auto *st = ty->getPointerElementType();
+            return st->getStructNumElements() == 4 && st->getStructElementType(3)->isArrayTy()
+                && st->getStructElementType(3)->getArrayNumElements() == 0;
+        }
+        // An immortal string in read-only data, shared by equal literals
+        llvm::Constant *getStringLiteral(const std::string &val)
+        {
+            if (val.empty())
+                return llvm::ConstantPointerNull::get(getStringTy());
+            auto &literal = strLiterals[val];
+            if (literal == nullptr)
+            {
+                auto *len = builder.getInt32(val.size());
+                auto *init = llvm::ConstantStruct::getAnon({builder.getInt32(-1), len, len, llvm::ConstantDataArray::getString(_module->getContext(), val)});
+                auto *gv = new llvm::GlobalVariable(*_module, init->getType(), true, llvm::GlobalValue::PrivateLinkage, init, ".str");
+                gv->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+                literal = llvm::ConstantExpr::getBitCast(gv, getStringTy());
+            }
+            return literal;
+        }
+        // Takes ownership of str, a reference returned by a call, until the end of the statement
+        llvm::Value *temporary(llvm::Value *str)
+        {
+            temporaries.push_back(str);
+            return str;
+        }
+        // Releases the temporaries of the statement, after its last use of them
+        void releaseTemporaries()
+        {
+            for (auto *str : temporaries)
+                builder.CreateCall(strReleaseFunc, str);
+            temporaries.clear();
+        }
+        // str(value) of an integer, char or real as a temporary, nullptr for other types
+        llvm::Value *createStr(llvm::Value *value)
+        {
+            auto *ty = value->getType();
+            if (ty->isIntegerTy(32))
+                return temporary(builder.CreateCall(strOfIntFunc, value));
+            if (ty->isIntegerTy(8))
+                return temporary(builder.CreateCall(strOfCharFunc, value));
+            if (ty->isDoubleTy())
+                return temporary(builder.CreateCall(strOfRealFunc, value));
+            return nullptr;
+        }
+        // *dst := str; a temporary is moved into dst instead of counting another reference
+        void assignString(llvm::Value *dst, llvm::Value *str)
+        {
+            auto it = std::find(temporaries.begin(), temporaries.end(), str);
+            if (it == temporaries.end())
+            {
+                builder.CreateCall(strAssignFunc, {dst, str});
+                return;
+            }
+            temporaries.erase(it);
+            auto *old = builder.CreateLoad(dst);
+            builder.CreateStore(str, dst);
+            builder.CreateCall(strReleaseFunc, old);
+        }
+        llvm::Value *createStrLength(llvm::Value *str)
+        {
+            auto *func = builder.GetInsertBlock()->getParent();
+            auto *empty = builder.GetInsertBlock();
+            auto *load = llvm::BasicBlock::Create(_module->getContext(), "len", func);
+            auto *cont = llvm::BasicBlock::Create(_module->getContext(), "cont", func);
+            builder.CreateCondBr(builder.CreateIsNull(str), cont, load);
+            builder.SetInsertPoint(load);
+            auto *len = builder.CreateLoad(builder.CreateInBoundsGEP(str, {builder.getInt32(0), builder.getInt32(1)}));
+            builder.CreateBr(cont);
+            builder.SetInsertPoint(cont);
+            auto *phi = builder.CreatePHI(builder.getInt32Ty(), 2);
+            phi->addIncoming(builder.getInt32(0), empty);
+            phi->addIncoming(len, load);
+            return phi;
+        }
+        // Address of str[index] to read, strings index from 0. An index outside of the string,
+        // which is any index of the empty string, reads #0; writing there is a runtime error.
+        llvm::Value *getStrCharPtr(llvm::Value *str, llvm::Value *index)
+        {
+            if (strNulChar == nullptr)
+            {
+                strNulChar = new llvm::GlobalVariable(*_module, builder.getInt8Ty(), true, llvm::GlobalValue::PrivateLinkage, builder.getInt8(0), ".str.nul");
+                strNulChar->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+            }
+            auto *func = builder.GetInsertBlock()->getParent();
+            auto *empty = builder.GetInsertBlock();
+            auto *check = llvm::BasicBlock::Create(_module->getContext(), "idx", func);
+            auto *cont = llvm::BasicBlock::Create(_module->getContext(), "cont", func);
+            builder.CreateCondBr(builder.CreateIsNull(str), cont, check);
+            builder.SetInsertPoint(check);
+            auto *len = builder.CreateLoad(builder.CreateInBoundsGEP(str, {builder.getInt32(0), builder.getInt32(1)}));
+            // unsigned, so a negative index is out of range too
+            auto *inRange = builder.CreateICmpULT(index, len);
+            auto *ptr = builder.CreateSelect(inRange, builder.CreateInBoundsGEP(str, {builder.getInt32(0), builder.getInt32(3), index}), strNulChar);
+            builder.CreateBr(cont);
+            builder.SetInsertPoint(cont);
+            auto *phi = builder.CreatePHI(builder.getInt8PtrTy(), 2);
+            phi->addIncoming(strNulChar, empty);
+            phi->addIncoming(ptr, check);
+            return phi;
+        }
+        // Empties the strings of a new local. The routine releases them when it returns,
+        // unless the local is its return value, which the caller takes over.
+        void initStrings(llvm::Value *ptr, bool release = true)
+        {
+            if (!containsString(ptr->getType()->getPointerElementType()))
+                return;
+            forEachString(ptr, [this](llvm::Value *str) { builder.CreateStore(llvm::ConstantPointerNull::get(getStringTy()), str); });
+            if (release)
+                getScope().finalize.push_back(ptr);
+        }
+        // Counts the references of a value param to the caller's strings; the routine releases them when it returns
+        void retainStrings(llvm::Value *ptr)
+        {
+            if (!containsString(ptr->getType()->getPointerElementType()))
+                return;
+            forEachString(ptr, [this](llvm::Value *str) { builder.CreateCall(strRetainFunc, builder.CreateLoad(str)); });
+            getScope().finalize.push_back(ptr);
+        }
+        // Releases the strings of the locals and value params of the routine, before it returns
+        void releaseLocals()
+        {
+            for (auto *ptr : getScope().finalize)
+                forEachString(ptr, [this](llvm::Value *str) { builder.CreateCall(strReleaseFunc, builder.CreateLoad(str)); });
+        }
+
+        llvm::AllocaInst *createEntryAlloca(llvm::Type *ty)
         {
-            auto *value = _module->getGlobalVariable("__tmp_str");
-            if (value == nullptr)
-                throw CodegenException("Global temp string not found");
-            llvm::Value *zero = llvm::ConstantInt::getSigned(builder.getInt32Ty(), 0);
-            return builder.CreateInBoundsGEP(value, {zero, zero});
+            auto &entry = builder.GetInsertBlock()->getParent()->getEntryBlock();
+            llvm::IRBuilder<> tmpBuilder(&entry, entry.begin());
+            return tmpBuilder.CreateAlloca(ty);
         }
 
-        std::string getTrace() 
+        // Opens the scope of a routine, its symbols shadow those of the enclosing routines
+        void enterScope(const std::string &routine)
+        {
+            scopes.emplace_back(routine);
+            scopeStack.push_back(&scopes.back());
+        }
+        void leaveScope()
+        {
+            assert(scopeStack.size() > 1 && "Cannot leave the global scope");
+            scopeStack.pop_back();
+        }
+        Scope &getScope() { return *scopeStack.back(); }
+        Scope &getGlobalScope() { return scopes.front(); }
+        // Innermost scope first
+        llvm::iterator_range<std::vector<Scope *>::reverse_iterator> getScopeStack()
         {
-            if (traces.empty()) return "main";
-            return traces.back(); 
+            return llvm::make_range(scopeStack.rbegin(), scopeStack.rend());
         }
 
-        llvm::Value *getLocal(const std::string &key) 
+        const std::string &getTrace() 
         {
-            auto V = locals.find(key);
-            if (V == locals.end())
-                return nullptr;
-            return V->second;
-        };
-        bool setLocal(const std::string &key, llvm::Value *value) 
+            return scopeStack.back()->name; 
+        }
+
+        // get* only look at the current scope, find* resolve a name through the enclosing scopes,
+        // set* declare in the current scope and return false if the name is taken
+        llvm::Value *getLocal(Symbol name) 
         {
-            if (getLocal(key))
-                return false;
-            locals[key] = value;
-            return true;
+            return getScope().locals.lookup(name);
         }
-        llvm::Value *getConst(const std::string &key) 
+        bool setLocal(Symbol name, llvm::Value *value) 
         {
-            auto V = consts.find(key);
-            if (V == consts.end())
-                return nullptr;
-            return V->second;
-        };
-        bool setConst(const std::string &key, llvm::Value *value) 
+            return insert(&Scope::locals, name, value);
+        }
+        llvm::Value *getConst(Symbol name) 
         {
-            if (getConst(key))
-                return false;
-            consts[key] = value;
-            return true;
+            return getScope().consts.lookup(name);
         }
-        llvm::Constant* getConstVal(const std::string &key) 
+        bool setConst(Symbol name, llvm::Value *value) 
         {
-            auto V = constVals.find(key);
-            if (V == constVals.end())
-                return nullptr;
-            return V->second;
-        };
-        llvm::ConstantInt* getConstInt(const std::string &key) 
+            return insert(&Scope::consts, name, value);
+        }
+        llvm::Constant *findConstVal(Symbol name) 
         {
-            auto V = constVals.find(key);
-            if (V == constVals.end())
+            auto *V = find(&Scope::constVals, name);
+            return V == nullptr ? nullptr : *V;
+        }
+        llvm::ConstantInt *findConstInt(Symbol name) 
+        {
+            llvm::Constant *val = findConstVal(name);
+            if (val == nullptr)
                 return nullptr;
-            llvm::Constant *val = V->second;
             if (!val->getType()->isIntegerTy())
                 throw CodegenException("Case branch must be integer type!");
             return llvm::cast<llvm::ConstantInt>(val);
-        };
-        bool setConstVal(const std::string &key, llvm::Constant* value) 
-        {
-            if (getConstVal(key))
-                return false;
-            constVals[key] = value;
-            return true;
-        }
-        std::shared_ptr<std::pair<int, int>> getArrayEntry(const std::string &key) 
-        {
-            auto V = arrTable.find(key);
-            if (V == arrTable.end())
-                return nullptr;
-            return V->second;
         }
-        bool setArrayEntry(const std::string &key, const std::shared_ptr<std::pair<int, int>> &value) 
+        bool setConstVal(Symbol name, llvm::Constant *value) 
         {
-            if (getArrayEntry(key))
-                return false;
-            assert(value != nullptr);
-            arrTable[key] = value;
-            return true;
+            return insert(&Scope::constVals, name, value);
         }
-        bool setArrayEntry(const std::string &key, const std::shared_ptr<ArrayTypeNode> &arr) 
+        TypeNode *findVarType(Symbol name) 
         {
-            if (getArrayEntry(key))
-                return false;
-            assert(arr != nullptr);
-            auto st = arr->range_start->codegen(*this), ed = arr->range_end->codegen(*this);
-            int s = llvm::cast<llvm::ConstantInt>(st)->getSExtValue(), 
-                e = llvm::cast<llvm::ConstantInt>(ed)->getSExtValue();
-            auto value = std::make_shared<std::pair<int, int>>(s, e);
-            arrTable[key] = value;
-            return true;
+            auto *V = find(&Scope::varTypes, name);
+            return V == nullptr ? nullptr : *V;
         }
-        bool setArrayEntry(const std::string &key, const int start, const int end) 
+        bool setVarType(Symbol name, TypeNode *type) 
         {
-            if (getArrayEntry(key))
-                return false;
-            assert(start <= end);
-            auto value = std::make_shared<std::pair<int, int>>(start, end);
-            arrTable[key] = value;
-            return true;
+            assert(type != nullptr);
+            return insert(&Scope::varTypes, name, type->resolve(*this));
         }
-        std::shared_ptr<ArrayTypeNode> getArrayAlias(const std::string &key) 
+        ArrayTypeNode *findArrayAlias(Symbol name) 
         {
-            auto V = arrAliases.find(key);
-            if (V == arrAliases.end())
-                return nullptr;
-            return V->second;
+            auto *V = find(&Scope::arrAliases, name);
+            return V == nullptr ? nullptr : *V;
         }
-        bool setArrayAlias(const std::string &key, const std::shared_ptr<ArrayTypeNode> &value) 
+        bool setArrayAlias(Symbol name, ArrayTypeNode *value) 
         {
-            if (getArrayAlias(key))
-                return false;
             assert(value != nullptr);
-            arrAliases[key] = value;
-            return true;
+            return insert(&Scope::arrAliases, name, value);
         }
-        std::shared_ptr<RecordTypeNode> getRecordAlias(const std::string &key) 
+        RecordTypeNode *findRecordAlias(Symbol name) 
         {
-            auto V = recAliases.find(key);
-            if (V == recAliases.end())
-                return nullptr;
-            return V->second;
+            auto *V = find(&Scope::recAliases, name);
+            return V == nullptr ? nullptr : *V;
         }
-        bool setRecordAlias(const std::string &key, const std::shared_ptr<RecordTypeNode> &value) 
+        bool setRecordAlias(Symbol name, RecordTypeNode *value) 
         {
-            if (getRecordAlias(key))
-                return false;
             assert(value != nullptr);
-            recAliases[key] = value;
-            return true;
+            return insert(&Scope::recAliases, name, value);
         }
-        llvm::Type *getAlias(const std::string &key) 
+        llvm::Type *findAlias(Symbol name) 
         {
-            auto V = aliases.find(key);
-            if (V == aliases.end())
-                return nullptr;
-            return V->second;
+            auto *V = find(&Scope::aliases, name);
+            return V == nullptr ? nullptr : *V;
         }
-        bool setAlias(const std::string &key, llvm::Type *value) 
+        bool setAlias(Symbol name, llvm::Type *value) 
         {
-            if (getAlias(key))
-                return false;
-            aliases[key] = value;
-            return true;
+            return insert(&Scope::aliases, name, value);
         }
         llvm::IRBuilder<> &getBuilder()
         {
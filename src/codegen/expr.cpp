@@ -101,41 +101,78 @@ namespace spc
             throw CodegenException("Invaild operation between different types");
     }
 
+    llvm::Value *CustomProcNode::getRefArg(CodegenContext &context, ExprNode *arg, llvm::Function *func, unsigned index)
+    {
+        auto *paramTy = func->getFunctionType()->getParamType(index);
+        auto *elemTy = paramTy->getPointerElementType();
+        bool isConst = func->hasParamAttribute(index, llvm::Attribute::ReadOnly);
+        llvm::Value *ptr = nullptr;
+        if (is_ptr_of<LeftExprNode>(arg))
+        {
+            auto lhs = cast_node<LeftExprNode>(arg);
+            ptr = isConst ? lhs->getPtr(context) : lhs->getAssignPtr(context);
+        }
+        if (ptr != nullptr && ptr->getType() == paramTy)
+            return ptr;
+        if (!isConst)
+            throw CodegenException("Incompatible type in the " + std::to_string(index) + "th arg when calling " + name->name.str() + "(): var param expects a variable of the same type");
+
+        // const param with an rvalue argument: materialize it in a temporary
+        context.log() << "	Temporary for const param " << index << " of " << name->name.str() << std::endl;
+        auto *tmp = context.createEntryAlloca(elemTy);
+        auto *value = arg->codegen(context);
+        if (value->getType() != elemTy)
+            throw CodegenException("Incompatible type in the " + std::to_string(index) + "th arg when calling " + name->name.str() + "()");
+        context.getBuilder().CreateStore(value, tmp);
+        return tmp;
+    }
+
     llvm::Value *CustomProcNode::codegen(CodegenContext &context)
     {
         auto *func = context.getModule()->getFunction(name->name);
         if (!func)
-            throw CodegenException("Function not found: " + name->name + "()");
+            throw CodegenException("Function not found: " + name->name.str() + "()");
         size_t argCnt = 0;
         int index = 0;
         if (args != nullptr)
             argCnt = args->getChildren().size();
         if (func->arg_size() != argCnt)
-            throw CodegenException("Wrong number of arguments: " + name->name + "()");
+            throw CodegenException("Wrong number of arguments: " + name->name.str() + "()");
         auto *funcTy = func->getFunctionType();
         std::vector<llvm::Value*> values;
         if (args != nullptr)
             for (auto &arg : args->getChildren())
             {
+                auto *paramTy = funcTy->getParamType(index);
+                if (paramTy->isPointerTy() && !CodegenContext::isStringTy(paramTy)) // var/const param
+                {
+                    values.push_back(getRefArg(context, arg, func, index));
+                    index++;
+                    continue;
+                }
                 llvm::Value *argVal = arg->codegen(context);
-                auto *paramTy = funcTy->getParamType(index), *argTy = argVal->getType();
+                auto *argTy = argVal->getType();
                 if (paramTy->isDoubleTy() && argTy->isIntegerTy(32))
                     argVal = context.getBuilder().CreateSIToFP(argVal, paramTy);
                 else if (argTy->isDoubleTy() && paramTy->isIntegerTy(32))
                 {
-                    std::cerr << "Warning: casting REAL type to INTEGER type when calling function " << name->name << "()" << std::endl;
+                    std::cerr << "Warning: casting REAL type to INTEGER type when calling function " << name->name.str() << "()" << std::endl;
                     argVal = context.getBuilder().CreateFPToSI(argVal, paramTy);
                 }
                 else if (funcTy->getParamType(index) != argVal->getType())
-                    throw CodegenException("Incompatible type in the " + std::to_string(index) + "th arg when calling " + name->name + "()");
+                    throw CodegenException("Incompatible type in the " + std::to_string(index) + "th arg when calling " + name->name.str() + "()");
                 values.push_back(argVal);
                 index++;
             }
-        // if (func->getReturnType()->isArrayTy())
-        // {
+        auto *result = context.getBuilder().CreateCall(func, values);
+        if (CodegenContext::isStringTy(result->getType()))
+            return context.temporary(result);
+        return result;
+    }
 
-        // }
-        return context.getBuilder().CreateCall(func, values);
+    llvm::Value *FormatExprNode::codegen(CodegenContext &)
+    {
+        throw CodegenException("Field width and precision are only allowed in write() and writeln()");
     }
 
     llvm::Value *SysProcNode::codegen(CodegenContext &context)
@@ -144,76 +181,49 @@ namespace spc
             context.log() << "\tSysfunc WRITE" << std::endl;
             if (this->args != nullptr)
                 for (auto &arg : this->args->getChildren()) {
-                    auto *value = arg->codegen(context);
-                    assert(value != nullptr);
-                    auto x = value->getType();
-                    std::vector<llvm::Value*> func_args;
-                    if (value->getType()->isIntegerTy(32)) 
+                    // x:width:precision, by default as wide as needed and with 6 digits after the point
+                    ExprNode *expr = arg, *widthExpr = nullptr, *precisionExpr = nullptr;
+                    if (is_ptr_of<FormatExprNode>(arg))
                     {
-                        func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%d"));
-                        func_args.push_back(value);
+                        auto *format = cast_node<FormatExprNode>(arg);
+                        expr = format->expr, widthExpr = format->width, precisionExpr = format->precision;
                     }
+                    auto *value = expr->codegen(context);
+                    assert(value != nullptr);
+                    llvm::Value *width = context.getBuilder().getInt32(0), *precision = context.getBuilder().getInt32(6);
+                    if (widthExpr != nullptr && !(width = widthExpr->codegen(context))->getType()->isIntegerTy(32))
+                        throw CodegenException("Incompatible type of field width in write(): expected integer");
+                    if (precisionExpr != nullptr && !value->getType()->isDoubleTy())
+                        throw CodegenException("Precision in write() is only allowed for real");
+                    if (precisionExpr != nullptr && !(precision = precisionExpr->codegen(context))->getType()->isIntegerTy(32))
+                        throw CodegenException("Incompatible type of precision in write(): expected integer");
+                    if (value->getType()->isIntegerTy(32)) 
+                        context.getBuilder().CreateCall(context.writeIntFunc, {value, width});
                     else if (value->getType()->isIntegerTy(8)) 
-                    {
-                        func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%c")); 
-                        func_args.push_back(value); 
-                    }
+                        context.getBuilder().CreateCall(context.writeCharFunc, {value, width});
                     else if (value->getType()->isDoubleTy()) 
-                    {
-                        func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%f"));
-                        func_args.push_back(value);
-                    }
-                    else if (value->getType()->isArrayTy()) // String
-                    {
-                        auto *a = llvm::cast<llvm::ArrayType>(x);
-                        if (!a->getElementType()->isIntegerTy(8))
-                            throw CodegenException("Cannot print a non-char array");
-                        func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%s"));
-                        llvm::Value *valuePtr;
-                        if (is_ptr_of<LeftExprNode>(arg))
-                        {
-                            auto argId = cast_node<LeftExprNode>(arg);
-                            valuePtr = argId->getPtr(context);
-                        }
-                        // else if (is_ptr_of<RecordRefNode>(arg))
-                        // {
-                        //     auto argId = cast_node<RecordRefNode>(arg);
-                        //     valuePtr = argId->getPtr(context);
-                        // }
-                        // else if (is_ptr_of<ArrayRefNode>(arg))
-                        // {
-                        //     auto argId = cast_node<ArrayRefNode>(arg);
-                        //     valuePtr = argId->getPtr(context);
-                        // }
-                        else if (is_ptr_of<CustomProcNode>(arg))
-                            valuePtr = value;
-                        else
-                            assert(0);
-                        func_args.push_back(valuePtr);
-                    }
-                    else if (value->getType()->isPointerTy()) // String
-                    {
-                        func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%s"));
-                        func_args.push_back(value);
-                    }
+                        context.getBuilder().CreateCall(context.writeRealFunc, {value, width, precision});
+                    else if (CodegenContext::isStringTy(value->getType()))
+                        context.getBuilder().CreateCall(context.writeStrFunc, {value, width});
                     else 
-                        throw CodegenException("Incompatible type in read(): expected char, integer, real, array, string");
-                    context.getBuilder().CreateCall(context.printfFunc, func_args);
+                        throw CodegenException("Incompatible type in write(): expected char, integer, real, string");
                 }
             if (name == SysFunc::Writeln) {
-                context.getBuilder().CreateCall(context.printfFunc, context.getBuilder().CreateGlobalStringPtr("\n"));
+                context.getBuilder().CreateCall(context.writeCharFunc, {context.getBuilder().getInt8('\n'), context.getBuilder().getInt32(0)});
             }
             return nullptr;
         }
         else if (name == SysFunc::Read || name == SysFunc::Readln)
         {
             context.log() << "\tSysfunc READ" << std::endl;
+            // a prompt written before has to be seen
+            context.getBuilder().CreateCall(context.flushFunc);
             if (this->args != nullptr)
                 for (auto &arg : args->getChildren())
                 {
                     llvm::Value *ptr;
                     if (is_ptr_of<LeftExprNode>(arg))
-                        ptr = cast_node<LeftExprNode>(arg)->getPtr(context);
+                        ptr = cast_node<LeftExprNode>(arg)->getAssignPtr(context);
                     // else if (is_ptr_of<ArrayRefNode>(arg))
                     //     ptr = cast_node<ArrayRefNode>(arg)->getPtr(context);
                     // else if (is_ptr_of<RecordRefNode>(arg))
@@ -222,176 +232,57 @@ namespace spc
                     //     ptr = cast_node<ArrayRefNode>(arg)->getPtr(context);
                     else
                         throw CodegenException("Argument in read() must be identifier or array/record reference");
-                    std::vector<llvm::Value*> func_args;
                     if (ptr->getType()->getPointerElementType()->isIntegerTy(8))
-                    { 
-                        func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%c")); 
-                        func_args.push_back(ptr); 
-                    }
+                        context.getBuilder().CreateCall(context.readCharFunc, ptr);
                     else if (ptr->getType()->getPointerElementType()->isIntegerTy(32))
-                    { 
-                        func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%d")); 
-                        func_args.push_back(ptr); 
-                    }
+                        context.getBuilder().CreateCall(context.readIntFunc, ptr);
                     else if (ptr->getType()->getPointerElementType()->isDoubleTy())
-                    { 
-                        func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%lf")); 
-                        func_args.push_back(ptr); 
-                    }
-                    // String support
-                    else if (ptr->getType()->getPointerElementType()->isArrayTy() && llvm::cast<llvm::ArrayType>(ptr->getType()->getPointerElementType())->getElementType()->isIntegerTy(8))
+                        context.getBuilder().CreateCall(context.readRealFunc, ptr);
+                    // a word for read, the rest of the line for readln
+                    else if (CodegenContext::isStringTy(ptr->getType()->getPointerElementType()))
                     {
-                        if (name == SysFunc::Read)
-                            func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%s"));
-                        else // Readln
-                        {
-                            func_args.push_back(context.getBuilder().CreateGlobalStringPtr("%[^\n]"));
-                            if (arg != this->args->getChildren().back())
-                                std::cerr << "Warning in readln(): string type should be the last argument in readln(), otherwise the subsequent arguments cannot be read!" << std::endl;
-                        }
-                        func_args.push_back(ptr);
+                        if (name == SysFunc::Readln && arg != this->args->getChildren().back())
+                            std::cerr << "Warning in readln(): string type should be the last argument in readln(), otherwise the subsequent arguments cannot be read!" << std::endl;
+                        context.getBuilder().CreateCall(context.strReadFunc, {ptr, context.getBuilder().getInt32(name == SysFunc::Readln)});
                     }
                     else
                         throw CodegenException("Incompatible type in read(): expected char, integer, real, string");
-                    context.getBuilder().CreateCall(context.scanfFunc, func_args);
                 }
+            // Skip the rest of the line, the final '\n' included
             if (name == SysFunc::Readln)
-            {
-                // Flush all other inputs in this line
-                context.getBuilder().CreateCall(context.scanfFunc, context.getBuilder().CreateGlobalStringPtr("%*[^\n]"));
-                // Flush the final '\n'
-                context.getBuilder().CreateCall(context.getcharFunc);
-            }
+                context.getBuilder().CreateCall(context.readlnFunc);
             return nullptr;
         }
         else if (name == SysFunc::Concat)
         {
             context.log() << "\tSysfunc CONCAT" << std::endl;
-            std::string format;
-            std::list<llvm::Value*> func_args;
+            // the parts go to an array in the caller's frame, the runtime joins them with a single allocation
+            std::vector<llvm::Value*> parts;
             for (auto &arg : this->args->getChildren()) {
                 auto *value = arg->codegen(context);
-                auto x = value->getType();
-                if (value->getType()->isIntegerTy(32)) 
-                {
-                    format += "%d";
-                    func_args.push_back(value);
-                }
-                else if (value->getType()->isIntegerTy(8)) 
-                {
-                    format += "%c";
-                    func_args.push_back(value);
-                }
-                else if (value->getType()->isDoubleTy()) 
-                {
-                    format += "%f";
-                    func_args.push_back(value);
-                }
-                else if (value->getType()->isArrayTy()) // String
-                {
-                    auto *a = llvm::cast<llvm::ArrayType>(x);
-                    if (!a->getElementType()->isIntegerTy(8))
-                        throw CodegenException("Cannot concat a non-char array");
-                    format += "%s";
-                    llvm::Value *valuePtr;
-                    if (is_ptr_of<LeftExprNode>(arg))
-                    {
-                        auto argId = cast_node<LeftExprNode>(arg);
-                        valuePtr = argId->getPtr(context);
-                    }
-                    // else if (is_ptr_of<RecordRefNode>(arg))
-                    // {
-                    //     auto argId = cast_node<RecordRefNode>(arg);
-                    //     valuePtr = argId->getPtr(context);
-                    // }
-                    // else if (is_ptr_of<ArrayRefNode>(arg))
-                    // {
-                    //     auto argId = cast_node<ArrayRefNode>(arg);
-                    //     valuePtr = argId->getPtr(context);
-                    // }
-                    else
-                        assert(0);
-                    func_args.push_back(valuePtr);
-                }
-                else if (value->getType()->isPointerTy()) // String
-                {
-                    format += "%s";
-                    func_args.push_back(value);
-                }
-                else 
-                    throw CodegenException("Incompatible type in concat(): expected char, integer, real, array, string");        
+                if (!CodegenContext::isStringTy(value->getType()))
+                    value = context.createStr(value);
+                if (value == nullptr)
+                    throw CodegenException("Incompatible type in concat(): expected char, integer, real, string");        
+                parts.push_back(value);
             }
-            func_args.push_front(context.getBuilder().CreateGlobalStringPtr(format.c_str()));
-            func_args.push_front(context.getTempStrPtr());
-            // sprintf(__tmp_str, "...formats", ...args);
-            std::vector<llvm::Value*> func_args_vec(func_args.begin(), func_args.end());
-            context.getBuilder().CreateCall(context.sprintfFunc, func_args_vec);
-            return context.getTempStrPtr();
+            auto *array = context.createEntryAlloca(llvm::ArrayType::get(context.getStringTy(), parts.size()));
+            auto *zero = context.getBuilder().getInt32(0);
+            for (unsigned i = 0; i < parts.size(); i++)
+                context.getBuilder().CreateStore(parts[i], context.getBuilder().CreateInBoundsGEP(array, {zero, context.getBuilder().getInt32(i)}));
+            llvm::Value *first = context.getBuilder().CreateInBoundsGEP(array, {zero, zero});
+            llvm::Value *count = context.getBuilder().getInt32(parts.size());
+            return context.temporary(context.getBuilder().CreateCall(context.strConcatFunc, {first, count}));
         }
         else if (name == SysFunc::Length)
         {
             context.log() << "\tSysfunc LENGTH" << std::endl;
             if (args->getChildren().size() != 1)
                 throw CodegenException("Wrong number of arguments in length(): expected 1");
-            auto arg = args->getChildren().front();
-            auto *value = arg->codegen(context);
-            auto *ty = value->getType();
-            llvm::Value *zero = llvm::ConstantInt::getSigned(context.getBuilder().getInt32Ty(), 0);
-            // context.log() << ty->getTypeID() << std::endl;
-            if (ty->isArrayTy() && ty->getArrayElementType()->isIntegerTy(8))
-            {
-                // context.log() << "\tqqqqqq" << std::endl;
-                llvm::Value *valPtr;
-                if (is_ptr_of<LeftExprNode>(arg))
-                    valPtr = context.getBuilder().CreateInBoundsGEP(cast_node<LeftExprNode>(arg)->getPtr(context), {zero, zero});
-                // else if (is_ptr_of<RecordRefNode>(arg))
-                //     valPtr = context.getBuilder().CreateInBoundsGEP(cast_node<RecordRefNode>(arg)->getPtr(context), {zero, zero});
-                // else if (is_ptr_of<ArrayRefNode>(arg))
-                //     valPtr = context.getBuilder().CreateInBoundsGEP(cast_node<ArrayRefNode>(arg)->getPtr(context), {zero, zero});
-                else if (is_ptr_of<CustomProcNode>(arg))
-                    valPtr = context.getBuilder().CreateInBoundsGEP(value, {zero, zero});
-                else
-                    assert(0);
-                return context.getBuilder().CreateCall(context.strlenFunc, valPtr);
-            }
-            else if (ty->isPointerTy())
-            {
-                // context.log() << "\tpppppp" << std::endl;
-                if(ty == context.getBuilder().getInt8PtrTy())
-                    return context.getBuilder().CreateCall(context.strlenFunc, value);
-                else if (ty->getPointerElementType()->isIntegerTy(8))
-                {
-                    llvm::Value *valPtr = context.getBuilder().CreateGEP(value, zero);
-                    return context.getBuilder().CreateCall(context.atoiFunc, valPtr);
-                }
-                else if (ty->getPointerElementType()->isArrayTy())
-                {
-                    // context.log() << "\tpppppp" << std::endl;
-                    llvm::Value *valPtr = context.getBuilder().CreateInBoundsGEP(value, {zero, zero});
-                    return context.getBuilder().CreateCall(context.strlenFunc, valPtr);
-                }
-                else
-                {
-                    // context.log() << ty->getPointerElementType()->getTypeID() << std::endl;
-                    throw CodegenException("Incompatible type in length(): expected string");
-                }
-            }
-            // else if (ty->isIntegerTy(8))
-            // {
-            //     if (!is_ptr_of<IdentifierNode>(arg))
-            //         throw CodegenException("Incompatible type in length(): expected string2");
-            //     std::shared_ptr<std::pair<int,int>> arrEntry;
-            //     auto argId = cast_node<IdentifierNode>(arg);
-            //     arrEntry = context.getArrayEntry(context.getTrace() + "." + argId->name);
-            //     if (arrEntry == nullptr)
-            //         throw CodegenException("Incompatible type in length(): expected string3");
-            //     return context.getBuilder().CreateCall(context.strlenFunc, argId->getPtr(context));
-            // }
-            else
-            {
-                // context.log() << ty->getTypeID() << std::endl;
+            auto *value = args->getChildren().front()->codegen(context);
+            if (!CodegenContext::isStringTy(value->getType()))
                 throw CodegenException("Incompatible type in length(): expected string");
-            }
+            return context.createStrLength(value);
         }
         else if (name == SysFunc::Abs)
         {
@@ -411,71 +302,20 @@ namespace spc
             context.log() << "\tSysfunc VAL" << std::endl;
             if (args->getChildren().size() != 1)
                 throw CodegenException("Wrong number of arguments in val(): expected 1");
-            auto arg = args->getChildren().front();
-            auto *value = arg->codegen(context);
-            auto *ty = value->getType();
-            llvm::Value *zero = llvm::ConstantInt::getSigned(context.getBuilder().getInt32Ty(), 0);
-            if (ty->isArrayTy() && ty->getArrayElementType()->isIntegerTy(8))
-            {
-                llvm::Value *valPtr;
-                if (is_ptr_of<LeftExprNode>(arg))
-                    valPtr = context.getBuilder().CreateInBoundsGEP(cast_node<LeftExprNode>(arg)->getPtr(context), {zero, zero});
-                // else if (is_ptr_of<RecordRefNode>(arg))
-                //     valPtr = context.getBuilder().CreateInBoundsGEP(cast_node<RecordRefNode>(arg)->getPtr(context), {zero, zero});
-                // else if (is_ptr_of<ArrayRefNode>(arg))
-                //     valPtr = context.getBuilder().CreateInBoundsGEP(cast_node<ArrayRefNode>(arg)->getPtr(context), {zero, zero});
-                else if (is_ptr_of<CustomProcNode>(arg))
-                    valPtr = context.getBuilder().CreateInBoundsGEP(value, {zero, zero});
-                else
-                    assert(0);
-                return context.getBuilder().CreateCall(context.atoiFunc, valPtr);
-            }
-            else if (ty->isPointerTy())
-            {
-                if(ty == context.getBuilder().getInt8PtrTy())
-                    return context.getBuilder().CreateCall(context.atoiFunc, value);
-                else if (ty->getPointerElementType()->isIntegerTy(8))
-                {
-                    llvm::Value *valPtr = context.getBuilder().CreateGEP(value, zero);
-                    return context.getBuilder().CreateCall(context.atoiFunc, valPtr);
-                }
-                else if (ty->getPointerElementType()->isArrayTy())
-                {
-                    llvm::Value *valPtr = context.getBuilder().CreateInBoundsGEP(value, {zero, zero});
-                    return context.getBuilder().CreateCall(context.atoiFunc, valPtr);
-                }
-                else
-                    throw CodegenException("Incompatible type in val(): expected string");
-            }
-            else
+            auto *value = args->getChildren().front()->codegen(context);
+            if (!CodegenContext::isStringTy(value->getType()))
                 throw CodegenException("Incompatible type in val(): expected string");
+            return context.getBuilder().CreateCall(context.atoiFunc, context.getBuilder().CreateCall(context.strCStrFunc, value));
         }
         else if (name == SysFunc::Str)
         {
             context.log() << "\tSysfunc STR" << std::endl;
             if (args->getChildren().size() != 1)
                 throw CodegenException("Wrong number of arguments in str(): expected 1");
-            auto arg = args->getChildren().front();
-            auto *value = arg->codegen(context);
-            auto *ty = value->getType();
-            llvm::Value *zero = llvm::ConstantInt::getSigned(context.getBuilder().getInt32Ty(), 0);
-            if (ty->isIntegerTy(8))
-            {
-                context.getBuilder().CreateCall(context.sprintfFunc, {context.getTempStrPtr(), context.getBuilder().CreateGlobalStringPtr("%c"), value});
-                return context.getTempStrPtr();
-            }
-            else if (ty->isIntegerTy(32))
-            {
-                context.getBuilder().CreateCall(context.sprintfFunc, {context.getTempStrPtr(), context.getBuilder().CreateGlobalStringPtr("%d"), value});
-                return context.getTempStrPtr();
-            }
-            else if (ty->isDoubleTy())
-            {
-                context.getBuilder().CreateCall(context.sprintfFunc, {context.getTempStrPtr(), context.getBuilder().CreateGlobalStringPtr("%f"), value});
-                return context.getTempStrPtr();
-            }
-            else
+            auto *value = context.createStr(args->getChildren().front()->codegen(context));
+            if (value == nullptr)
                 throw CodegenException("Incompatible type in str(): expected integer, char, real");
+            return value;
         }
         else if (name == SysFunc::Abs)
         {
@@ -568,30 +408,36 @@ namespace spc
     }
     llvm::Value *RecordRefNode::getPtr(CodegenContext &context)
     {
-        llvm::Value *value = name->getPtr(context);
+        return getFieldPtr(context, name->getPtr(context));
+    }
+    llvm::Value *RecordRefNode::getFieldPtr(CodegenContext &context, llvm::Value *value)
+    {
         assert(value != nullptr);
-        std::shared_ptr<RecordTypeNode> recTy = nullptr;
-        for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-        {
-            if ((recTy = context.getRecordAlias(*rit + "." + name->getSymbolName())) != nullptr)
-                break;
-        }
-        if (recTy == nullptr) recTy = context.getRecordAlias(name->getSymbolName());
-        if (recTy == nullptr) throw CodegenException(name->getSymbolName() + " is not a record");
+        TypeNode *type = name->getTypeNode(context);
+        if (!is_ptr_of<RecordTypeNode>(type)) throw CodegenException(name->getSymbolName() + " is not a record");
+        RecordTypeNode *recTy = cast_node<RecordTypeNode>(type);
         assert(value->getType()->getPointerElementType()->isStructTy());
-	    llvm::Value *idx = recTy->getFieldIdx(field->name, context);
+	    llvm::Value *idx = recTy->getFieldIdx(field->symbol, context);
         if (idx == nullptr)
-            throw CodegenException("'" + field->name + "' is not in record field of " + name->getSymbolName());
+            throw CodegenException("'" + field->name.str() + "' is not in record field of " + name->getSymbolName());
         llvm::Value *zero = llvm::ConstantInt::get(context.getBuilder().getInt32Ty(), 0, false);
         return context.getBuilder().CreateInBoundsGEP(value, {zero, idx});
     }
     llvm::Value *RecordRefNode::getAssignPtr(CodegenContext &context)
     {
-        return this->getPtr(context);
+        // the base is walked once, its indices may call functions
+        return getFieldPtr(context, name->getAssignPtr(context));
     }
     const std::string RecordRefNode::getSymbolName()
     {
-        return this->name->getSymbolName() + "." + this->field->name;
+        return this->name->getSymbolName() + "." + this->field->name.str();
+    }
+    TypeNode *RecordRefNode::getTypeNode(CodegenContext &context)
+    {
+        TypeNode *type = name->getTypeNode(context);
+        if (!is_ptr_of<RecordTypeNode>(type)) return nullptr;
+        TypeNode *fieldType = cast_node<RecordTypeNode>(type)->getFieldType(field->symbol);
+        return fieldType == nullptr ? nullptr : fieldType->resolve(context);
     }
 
     llvm::Value *ArrayRefNode::codegen(CodegenContext &context) 
@@ -603,17 +449,38 @@ namespace spc
     {
         llvm::Value *value = arr->getAssignPtr(context);
         assert(value != nullptr);
-        return this->getPtr(context);
+        // the chars of a string may be shared with other variables, the runtime copies them before the write
+        if (CodegenContext::isStringTy(value->getType()->getPointerElementType()))
+        {
+            auto *idx_value = context.getBuilder().CreateIntCast(this->index->codegen(context), context.getBuilder().getInt32Ty(), true);
+            return context.getBuilder().CreateCall(context.strAtFunc, {value, idx_value});
+        }
+        return getElementPtr(context, value);
     }
     const std::string ArrayRefNode::getSymbolName()
     {
         return this->arr->getSymbolName() + "[]";
     }
+    TypeNode *ArrayRefNode::getTypeNode(CodegenContext &context)
+    {
+        TypeNode *type = arr->getTypeNode(context);
+        if (!is_ptr_of<ArrayTypeNode>(type)) return nullptr;
+        return cast_node<ArrayTypeNode>(type)->itemType->resolve(context);
+    }
 
     llvm::Value *ArrayRefNode::getPtr(CodegenContext &context) 
     {
         llvm::Value *value = arr->getPtr(context);
         assert(value != nullptr);
+        if (CodegenContext::isStringTy(value->getType()->getPointerElementType()))
+        {
+            auto *idx_value = context.getBuilder().CreateIntCast(this->index->codegen(context), context.getBuilder().getInt32Ty(), true);
+            return context.getStrCharPtr(context.getBuilder().CreateLoad(value), idx_value);
+        }
+        return getElementPtr(context, value);
+    }
+    llvm::Value *ArrayRefNode::getElementPtr(CodegenContext &context, llvm::Value *value)
+    {
         auto *idx_value = context.getBuilder().CreateIntCast(this->index->codegen(context), context.getBuilder().getInt32Ty(), true);
         auto *ptr_type = value->getType()->getPointerElementType();
         std::vector<llvm::Value*> idx;
@@ -621,25 +488,10 @@ namespace spc
         // context.log() << "\tType: " << value->getType()->getTypeID() << std::endl;
 
         idx.push_back(llvm::ConstantInt::getSigned(context.getBuilder().getInt32Ty(), 0));
-        std::shared_ptr<std::pair<int,int>> range;
-        // bool is_local = false;
-        for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-        {
-            if ((range = context.getArrayEntry(*rit + "." + arr->getSymbolName())) != nullptr)
-            {
-                // is_local = true;
-                break;
-            }
-        }
-        if (range == nullptr)
-            range = context.getArrayEntry(arr->getSymbolName());
-        if (ptr_type->isArrayTy())
-        {
-            if (range == nullptr) std::cout << arr->getSymbolName() << std::endl;
-            assert(range != nullptr && "Fatal error: Array not found in array table!");
-        }
-        else if (range == nullptr)
+        TypeNode *type = arr->getTypeNode(context);
+        if (!is_ptr_of<ArrayTypeNode>(type))
             throw CodegenException(arr->getSymbolName() + " is not an array");
+        const std::pair<int, int> *range = &cast_node<ArrayTypeNode>(type)->getRange(context);
         
         llvm::ConstantInt *const_idx = llvm::dyn_cast<llvm::ConstantInt>(idx_value);
         if (const_idx != nullptr)
@@ -13,48 +13,47 @@ namespace spc
     }
     llvm::Constant *IdentifierNode::getConstVal(CodegenContext &context)
     {
-        llvm::Constant *value = nullptr;
-        for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-        {
-            if ((value = context.getConstVal(*rit + "." + name)) != nullptr)
-                break;
-        }
-        if (value == nullptr) value = context.getConstVal(name);
-        return value;
+        return context.findConstVal(symbol);
     }
     llvm::Value *IdentifierNode::getPtr(CodegenContext &context)
     {
         llvm::Value *value = nullptr;
-        for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
+        for (auto *scope : context.getScopeStack())
         {
-            if ((value = context.getLocal(*rit + "." + name)) != nullptr)
+            if (scope == &context.getGlobalScope())
                 break;
-            else if (context.getConst(*rit + "." + name) != nullptr)
-            {
-                value = context.getModule()->getGlobalVariable(*rit + "." + name);
+            if ((value = scope->locals.lookup(symbol)) != nullptr)
+                break;
+            // String consts of a routine live in a global variable
+            if ((value = llvm::dyn_cast_or_null<llvm::GlobalVariable>(scope->consts.lookup(symbol))) != nullptr)
                 break;
-            }
         }
         if (value == nullptr) value = context.getModule()->getGlobalVariable(name);
-        if (value == nullptr) throw CodegenException("Identifier not found in function " + context.getTrace() + ": " + name);
+        if (value == nullptr) throw CodegenException("Identifier not found in function " + context.getTrace() + ": " + name.str());
         return value;
     }
+    TypeNode *IdentifierNode::getTypeNode(CodegenContext &context)
+    {
+        return context.findVarType(symbol);
+    }
     llvm::Value *IdentifierNode::getAssignPtr(CodegenContext &context)
     {
-        if (context.getConst(name) != nullptr)
+        if (context.getGlobalScope().consts.count(symbol))
             throw CodegenException("Cannot assign to a const value!");
         llvm::Value *value = nullptr;
-        for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
+        for (auto *scope : context.getScopeStack())
         {
-            if ((value = context.getLocal(*rit + "." + name)) != nullptr)
+            if (scope == &context.getGlobalScope())
+                break;
+            if ((value = scope->locals.lookup(symbol)) != nullptr)
             {
-                if (context.getConst(*rit + "." + name) != nullptr)
+                if (scope->consts.count(symbol))
                     throw CodegenException("Cannot assign to a const value!");
                 break;
             }
         }
         if (value == nullptr) value = context.getModule()->getGlobalVariable(name);
-        if (value == nullptr) throw CodegenException("Identifier not found in function " + context.getTrace() + ": " + name);
+        if (value == nullptr) throw CodegenException("Identifier not found in function " + context.getTrace() + ": " + name.str());
         return value;
     }
 
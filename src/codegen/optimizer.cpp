@@ -0,0 +1,271 @@
+#include "optimizer.hpp"
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/GlobalIFunc.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include <stdexcept>
+
+namespace spc
+{
+
+    bool parseOptLevel(const std::string &level, OptLevel &result)
+    {
+        if (level.empty() || level == "2") result = OptLevel::O2;
+        else if (level == "0") result = OptLevel::O0;
+        else if (level == "1") result = OptLevel::O1;
+        else if (level == "3") result = OptLevel::O3;
+        else if (level == "s") result = OptLevel::Os;
+        else if (level == "z") result = OptLevel::Oz;
+        else return false;
+        return true;
+    }
+
+    const char *getOptLevelName(OptLevel level)
+    {
+        switch (level)
+        {
+            case OptLevel::O0: return "O0";
+            case OptLevel::O1: return "O1";
+            case OptLevel::O2: return "O2";
+            case OptLevel::O3: return "O3";
+            case OptLevel::Os: return "Os";
+            case OptLevel::Oz: return "Oz";
+        }
+        return "O0";
+    }
+
+    static llvm::CodeGenOpt::Level getCodeGenOptLevel(OptLevel level)
+    {
+        switch (level)
+        {
+            case OptLevel::O0: return llvm::CodeGenOpt::None;
+            case OptLevel::O1: return llvm::CodeGenOpt::Less;
+            case OptLevel::O3: return llvm::CodeGenOpt::Aggressive;
+            default: return llvm::CodeGenOpt::Default;
+        }
+    }
+
+    TargetConfig getHostTargetConfig()
+    {
+        TargetConfig config;
+        config.cpu = llvm::sys::getHostCPUName();
+        llvm::StringMap<bool> features;
+        if (llvm::sys::getHostCPUFeatures(features))
+            for (auto &f : features)
+            {
+                if (!config.features.empty()) config.features += ",";
+                config.features += (f.getValue() ? "+" : "-") + f.getKey().str();
+            }
+        return config;
+    }
+
+    std::unique_ptr<llvm::TargetMachine> createTargetMachine(OptLevel level, const TargetConfig &config, std::string &error)
+    {
+        auto triple = llvm::sys::getDefaultTargetTriple();
+        auto *target = llvm::TargetRegistry::lookupTarget(triple, error);
+        if (target == nullptr)
+            return nullptr;
+        llvm::TargetOptions options;
+        auto rm = llvm::Optional<llvm::Reloc::Model>();
+        std::unique_ptr<llvm::TargetMachine> tm(
+            target->createTargetMachine(triple, config.cpu, config.features, options, rm, llvm::None, getCodeGenOptLevel(level)));
+        if (tm != nullptr && !tm->getMCSubtargetInfo()->isCPUStringValid(config.cpu))
+        {
+            error = "Unknown CPU for " + triple + ": " + config.cpu;
+            return nullptr;
+        }
+        return tm;
+    }
+
+    // Functions are generated with the CPU of the target machine, unless cloned for another one
+    static void setTargetAttributes(llvm::Module &module, llvm::TargetMachine &tm)
+    {
+        for (auto &func : module)
+        {
+            if (func.isDeclaration() || func.hasFnAttribute("target-cpu"))
+                continue;
+            func.addFnAttr("target-cpu", tm.getTargetCPU());
+            if (!tm.getTargetFeatureString().empty())
+                func.addFnAttr("target-features", tm.getTargetFeatureString());
+        }
+    }
+
+    // Bit of a feature in __cpu_model.__cpu_features[0], as laid out by libgcc and compiler-rt
+    static int getX86FeatureBit(llvm::StringRef feature)
+    {
+        return llvm::StringSwitch<int>(feature)
+            .Case("popcnt", 2).Case("sse4.1", 7).Case("sse4.2", 8)
+            .Case("avx", 9).Case("avx2", 10).Case("fma", 14)
+            .Case("avx512f", 15).Case("bmi", 16).Case("bmi2", 17)
+            .Case("avx512vl", 20).Case("avx512bw", 21).Case("avx512dq", 22).Case("avx512cd", 23)
+            .Default(-1);
+    }
+
+    // Routines with a loop are where wider vectors pay off
+    static bool isHot(llvm::Function &func)
+    {
+        llvm::DominatorTree dt(func);
+        llvm::LoopInfo li(dt);
+        return !li.empty();
+    }
+
+    // Replaces every hot routine f by an ifunc whose resolver picks, once at load time, the first
+    // clone f.<feature> the running CPU supports, or the original, renamed f.default
+    static void multiversion(llvm::Module &module, const std::vector<std::string> &features)
+    {
+        llvm::Triple triple(module.getTargetTriple());
+        if (triple.getArch() != llvm::Triple::x86 && triple.getArch() != llvm::Triple::x86_64)
+            throw std::runtime_error("-fmultiversion is only supported on x86 targets");
+        std::vector<std::pair<std::string, unsigned>> masks;
+        for (auto &feature : features)
+        {
+            int bit = getX86FeatureBit(feature);
+            if (bit < 0)
+                throw std::runtime_error("Unknown feature for -fmultiversion: " + feature);
+            masks.emplace_back(feature, 1u << bit);
+        }
+
+        std::vector<llvm::Function *> hot;
+        for (auto &func : module)
+            if (!func.isDeclaration() && func.getName() != "main" && isHot(func))
+                hot.push_back(&func);
+        if (hot.empty())
+            return;
+
+        auto &ctx = module.getContext();
+        auto *int32Ty = llvm::Type::getInt32Ty(ctx);
+        auto *cpuModelTy = llvm::StructType::get(ctx, {int32Ty, int32Ty, int32Ty, llvm::ArrayType::get(int32Ty, 1)});
+        auto *cpuModel = module.getOrInsertGlobal("__cpu_model", cpuModelTy);
+        auto cpuInit = module.getOrInsertFunction("__cpu_indicator_init", llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), false));
+
+        for (auto *func : hot)
+        {
+            std::string name = func->getName();
+            func->setName(name + ".default");
+            auto *resolver = llvm::Function::Create(llvm::FunctionType::get(func->getType(), false),
+                                                    llvm::GlobalValue::InternalLinkage, name + ".resolver", &module);
+            auto *ifunc = llvm::GlobalIFunc::create(func->getFunctionType(), 0, func->getLinkage(), name, resolver, &module);
+            func->replaceAllUsesWith(ifunc);
+            func->setLinkage(llvm::GlobalValue::InternalLinkage);
+
+            std::vector<llvm::Function *> clones;
+            for (auto &mask : masks)
+            {
+                llvm::ValueToValueMapTy vmap;
+                auto *clone = llvm::CloneFunction(func, vmap);
+                clone->setName(name + "." + mask.first);
+                std::string cloneFeatures = func->getFnAttribute("target-features").getValueAsString();
+                clone->addFnAttr("target-features", (cloneFeatures.empty() ? "" : cloneFeatures + ",") + "+" + mask.first);
+                clones.push_back(clone);
+            }
+
+            llvm::IRBuilder<> builder(llvm::BasicBlock::Create(ctx, "entry", resolver));
+            // ifunc resolvers run before constructors, so the CPU model may not be filled in yet
+            builder.CreateCall(cpuInit);
+            auto *cpuFeatures = builder.CreateLoad(builder.CreateInBoundsGEP(cpuModelTy, cpuModel,
+                                                   {builder.getInt32(0), builder.getInt32(3), builder.getInt32(0)}));
+            llvm::Value *chosen = func;
+            for (size_t i = clones.size(); i-- > 0; )
+            {
+                auto *mask = builder.getInt32(masks[i].second);
+                auto *supported = builder.CreateICmpEQ(builder.CreateAnd(cpuFeatures, mask), mask);
+                chosen = builder.CreateSelect(supported, clones[i], chosen);
+            }
+            builder.CreateRet(chosen);
+        }
+    }
+
+    static llvm::PassBuilder::OptimizationLevel getPassBuilderLevel(OptLevel level)
+    {
+        switch (level)
+        {
+            case OptLevel::O1: return llvm::PassBuilder::OptimizationLevel::O1;
+            case OptLevel::O3: return llvm::PassBuilder::OptimizationLevel::O3;
+            case OptLevel::Os: return llvm::PassBuilder::OptimizationLevel::Os;
+            case OptLevel::Oz: return llvm::PassBuilder::OptimizationLevel::Oz;
+            default: return llvm::PassBuilder::OptimizationLevel::O2;
+        }
+    }
+
+    static const char *getPipelineName(LTOPhase phase)
+    {
+        switch (phase)
+        {
+            case LTOPhase::PreLink: return "lto-pre-link";
+            case LTOPhase::Link: return "lto";
+            default: return "default";
+        }
+    }
+
+    void optimizeModule(llvm::Module &module, llvm::TargetMachine &tm, const OptimizeOptions &options)
+    {
+        OptLevel level = options.level;
+        bool printPipeline = options.printPipeline;
+        module.setTargetTriple(tm.getTargetTriple().str());
+        module.setDataLayout(tm.createDataLayout());
+        setTargetAttributes(module, tm);
+        // before the pipeline, so that each clone is optimized with the cost model of its features
+        if (!options.multiversion.empty())
+            multiversion(module, options.multiversion);
+        if (level == OptLevel::O0)
+        {
+            if (printPipeline)
+                llvm::errs() << "Pipeline: none (-O0)\n";
+            return;
+        }
+        if (printPipeline)
+            llvm::errs() << "Pipeline: " << getPipelineName(options.lto) << "<" << getOptLevelName(level) << "> for " << tm.getTargetTriple().str()
+                         << " (cpu: " << tm.getTargetCPU() << ", features: " << tm.getTargetFeatureString() << ")"
+                         << (options.profileGenerate ? ", profile-generate" : "")
+                         << (options.profileUse.empty() ? "" : ", profile-use=" + options.profileUse) << "\n";
+
+        llvm::PassInstrumentationCallbacks callbacks;
+        if (options.timePasses)
+            options.timePasses->registerCallbacks(callbacks);
+
+        // IR level PGO: the pipeline instruments the CFG right after the early cleanups, or
+        // matches the profile against the same CFG, so both builds must use the same level
+        llvm::Optional<llvm::PGOOptions> pgo;
+        if (options.profileGenerate)
+            pgo = llvm::PGOOptions(options.profileGenerateFile, "", "", llvm::PGOOptions::IRInstr);
+        else if (!options.profileUse.empty())
+            pgo = llvm::PGOOptions(options.profileUse, "", "", llvm::PGOOptions::IRUse);
+
+        llvm::PassBuilder builder(&tm, llvm::PipelineTuningOptions(), pgo, &callbacks);
+        llvm::LoopAnalysisManager lam(printPipeline);
+        llvm::FunctionAnalysisManager fam(printPipeline);
+        llvm::CGSCCAnalysisManager cgam(printPipeline);
+        llvm::ModuleAnalysisManager mam(printPipeline);
+        // Registered first so that it is not replaced by the default, which knows no libc
+        llvm::Triple triple(module.getTargetTriple());
+        fam.registerPass([&] { return llvm::TargetLibraryAnalysis(llvm::TargetLibraryInfoImpl(triple)); });
+        builder.registerModuleAnalyses(mam);
+        builder.registerCGSCCAnalyses(cgam);
+        builder.registerFunctionAnalyses(fam);
+        builder.registerLoopAnalyses(lam);
+        builder.crossRegisterProxies(lam, fam, cgam, mam);
+
+        llvm::ModulePassManager mpm(printPipeline);
+        switch (options.lto)
+        {
+            case LTOPhase::PreLink: mpm = builder.buildLTOPreLinkDefaultPipeline(getPassBuilderLevel(level), printPipeline); break;
+            case LTOPhase::Link: mpm = builder.buildLTODefaultPipeline(getPassBuilderLevel(level), printPipeline, nullptr); break;
+            default: mpm = builder.buildPerModuleDefaultPipeline(getPassBuilderLevel(level), printPipeline); break;
+        }
+        mpm.run(module, mam);
+    }
+
+} // namespace spc
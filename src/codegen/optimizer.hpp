@@ -0,0 +1,72 @@
+#ifndef __OPTIMIZER__H__
+#define __OPTIMIZER__H__
+
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm
+{
+    class TimePassesHandler;
+}
+
+namespace spc
+{
+
+    enum class OptLevel { O0, O1, O2, O3, Os, Oz };
+
+    // Parses the level of a -O<level> flag ("", "0".."3", "s", "z"); a bare -O means -O2
+    bool parseOptLevel(const std::string &level, OptLevel &result);
+    const char *getOptLevelName(OptLevel level);
+
+    // CPU and features to generate code for (-march=, -mcpu=, -mattr=)
+    struct TargetConfig
+    {
+        std::string cpu = "generic";
+        // comma separated, e.g. "+avx2,-avx512f"
+        std::string features;
+    };
+    // -march=native; other -march values name a CPU like -mcpu
+    TargetConfig getHostTargetConfig();
+
+    // Which part of a link-time optimized build the module is (-emit-bc, -lto)
+    enum class LTOPhase { None, PreLink, Link };
+
+    struct OptimizeOptions
+    {
+        OptLevel level = OptLevel::O0;
+        // -print-pipeline: write the pipeline and every pass as it runs to stderr
+        bool printPipeline = false;
+        // -fmultiversion=: x86 features to clone routines for, most preferred first
+        std::vector<std::string> multiversion;
+        // -fprofile-generate[=<file>]: instrument the code, the program writes its
+        // profile to profileGenerateFile (default.profraw if empty) when it exits
+        bool profileGenerate = false;
+        std::string profileGenerateFile;
+        // -fprofile-use=<file>: profile merged by llvm-profdata to annotate the
+        // branch weights and function entry counts with
+        std::string profileUse;
+        // PreLink leaves the inlining and interprocedural work to the link, Link
+        // runs the whole-program pipeline over all modules merged into one
+        LTOPhase lto = LTOPhase::None;
+        // -ftime-report/-freport-json: times every pass into its timer group, which
+        // the caller keeps alive until the timings are reported
+        llvm::TimePassesHandler *timePasses = nullptr;
+    };
+
+    // Target machine for the default triple and config, with the code generator tuned for level.
+    // Returns nullptr and sets error if the triple or CPU is not supported.
+    std::unique_ptr<llvm::TargetMachine> createTargetMachine(OptLevel level, const TargetConfig &config, std::string &error);
+
+    // Runs LLVM's standard per-module (or LTO pre-link / link) pipeline over module, with the cost models
+    // (TTI, target library info) of tm. The module's triple, data layout and the
+    // target-cpu/target-features of its functions are set to tm's first.
+    // Throws std::runtime_error if multiversioning is requested for a target that has no dispatcher.
+    void optimizeModule(llvm::Module &module, llvm::TargetMachine &tm, const OptimizeOptions &options);
+
+} // namespace spc
+
+#endif
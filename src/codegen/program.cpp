@@ -1,13 +1,42 @@
 #include "utils/ast.hpp"
+#include "utils/unit_interface.hpp"
 #include "codegen_context.hpp"
 
 namespace spc
 {
-    
+
+    // Declares the interfaces of the used units, and of the units those interfaces use, in the global scope
+    static void importUnits(IdentifierList *uses, CodegenContext &context)
+    {
+        for (auto *use : uses->getChildren())
+        {
+            if (!context.units.insert(use->name).second)
+                continue;
+            std::string path = UnitInterface::find(use->name, context.unitPath);
+            if (path.empty())
+                throw CodegenException("Unit not found: " + use->name.str() + " (no " + use->name.str() + ".spi in the unit path)");
+            UnitNode *unit;
+            try
+            {
+                unit = UnitInterface::read(path);
+            }
+            catch (const std::runtime_error &e)
+            {
+                throw CodegenException(e.what());
+            }
+            if (unit->getName() != use->name)
+                throw CodegenException("Interface file " + path + " belongs to unit " + unit->getName());
+            context.log() << "Importing unit " << use->name.str() << " from " << path << std::endl;
+            importUnits(unit->getInterfaceUses(), context);
+            unit->declareInterface(context, true);
+        }
+    }
+
     llvm::Value *ProgramNode::codegen(CodegenContext &context)
     {
         context.is_subroutine = false;
         context.log() << "Entering main program" << std::endl;
+        importUnits(uses, context);
         auto *funcT = llvm::FunctionType::get(context.getBuilder().getInt32Ty(), false);
         auto *mainFunc = llvm::Function::Create(funcT, llvm::Function::ExternalLinkage, "main", *context.getModule());
         auto *block = llvm::BasicBlock::Create(context.getModule()->getContext(), "entry", mainFunc);
@@ -27,143 +56,187 @@ namespace spc
         context.getBuilder().SetInsertPoint(block);
         context.log() << "Entering global body part" << std::endl;
         body->codegen(context);
+        context.getBuilder().CreateCall(context.flushFunc);
         context.getBuilder().CreateRet(context.getBuilder().getInt32(0));
 
         llvm::verifyFunction(*mainFunc, &llvm::errs());
-
-        // Optimizations
-        if (context.fpm)
-            context.fpm->run(*mainFunc);
-        if (context.mpm)
-            context.mpm->run(*context.getModule());
         return nullptr;
     }
 
-    llvm::Value *RoutineNode::codegen(CodegenContext &context)
+    llvm::Value *UnitNode::codegen(CodegenContext &context)
     {
-        context.log() << "Entering function " + name->name << std::endl;
+        context.is_subroutine = false;
+        context.log() << "Entering unit " << name->name.str() << std::endl;
+        context.units.insert(name->name);
+        importUnits(interfaceUses, context);
+        importUnits(implementationUses, context);
 
-        if (context.getModule()->getFunction(name->name) != nullptr)
-            throw CodegenException("Duplicate function definition: " + name->name);
+        context.log() << "Entering interface part" << std::endl;
+        declareInterface(context, false);
+
+        context.log() << "Entering global const part" << std::endl;
+        header->constList->codegen(context);
+        context.log() << "Entering global type part" << std::endl;
+        header->typeList->codegen(context);
+        context.log() << "Entering global var part" << std::endl;
+        header->varList->codegen(context);
+        context.is_subroutine = true;
+        context.log() << "Entering global routine part" << std::endl;
+        header->subroutineList->codegen(context);
+        context.is_subroutine = false;
 
-        context.traces.push_back(name->name);
+        // Only what the interface declares is visible outside of the unit's object
+        llvm::StringSet<> exported;
+        if (!context.pendingRoutines.empty())
+            throw CodegenException("Routine of the interface is not implemented: " + context.pendingRoutines.begin()->getKey().str());
+        for (auto *routine : interfaceHead->subroutineList->getChildren())
+            exported.insert(routine->getName());
+        for (auto *var : interfaceHead->varList->getChildren())
+            exported.insert(var->name->name);
+        for (auto *decl : interfaceHead->constList->getChildren())
+            exported.insert(decl->name->name);
+        for (auto &func : context.getModule()->functions())
+            if (!func.isDeclaration() && func.hasExternalLinkage() && !exported.count(func.getName()))
+                func.setLinkage(llvm::GlobalValue::InternalLinkage);
+        for (auto &gv : context.getModule()->globals())
+            if (!gv.isDeclaration() && gv.hasExternalLinkage() && !exported.count(gv.getName()))
+                gv.setLinkage(llvm::GlobalValue::InternalLinkage);
+        return nullptr;
+    }
 
+    void UnitNode::declareInterface(CodegenContext &context, bool imported)
+    {
+        for (auto *decl : interfaceHead->constList->getChildren())
+        {
+            // a string const has a global variable
+            auto *gv = llvm::cast_or_null<llvm::GlobalVariable>(decl->codegen(context));
+            if (gv != nullptr && imported)
+                gv->setInitializer(nullptr);
+        }
+        interfaceHead->typeList->codegen(context);
+        for (auto *decl : interfaceHead->varList->getChildren())
+        {
+            auto *gv = llvm::cast<llvm::GlobalVariable>(decl->codegen(context));
+            if (imported)
+                gv->setInitializer(nullptr);
+        }
+        for (auto *routine : interfaceHead->subroutineList->getChildren())
+        {
+            routine->declare(context);
+            if (!imported)
+                context.pendingRoutines.insert(routine->getName());
+        }
+    }
+
+    llvm::FunctionType *RoutineNode::getFunctionType(CodegenContext &context)
+    {
         std::vector<llvm::Type *> types;
-        std::vector<std::string> names;
         for (auto &p : params->getChildren()) 
         {
             auto *ty = p->type->getLLVMType(context);
             if (ty == nullptr)
                 throw CodegenException("Unsupported function param type");
+            // var params, and const params of aggregate type, are passed by reference
+            if (p->mode == ParamMode::ByVar || (p->mode == ParamMode::ByConst && (ty->isArrayTy() || ty->isStructTy())))
+                ty = ty->getPointerTo();
             types.push_back(ty);
-            names.push_back(p->name->name);
-            if (ty->isArrayTy())
-            {
-                if (p->type->type == Type::String)
-                    context.setArrayEntry(name->name + "." + p->name->name, 0, 255);
-                else if (p->type->type == Type::Array)
-                {
-                    auto arrTy = cast_node<ArrayTypeNode>(p->type);
-                    assert(arrTy != nullptr);
-                    context.setArrayEntry(name->name + "." + p->name->name, arrTy);
-                    arrTy->insertNestedArray(name->name + "." + p->name->name, context);
-                }
-                else if (p->type->type == Type::Alias)
-                {
-                    std::string aliasName = cast_node<AliasTypeNode>(p->type)->name->name;
-                    std::shared_ptr<ArrayTypeNode> a;
-                    for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-                        if ((a = context.getArrayAlias(*rit + "." + aliasName)) != nullptr)
-                            break;
-                    if (a == nullptr) a = context.getArrayAlias(aliasName);
-                    assert(a != nullptr && "Fatal error: array type not found!");
-                    context.setArrayEntry(name->name + "." + p->name->name, a);
-                    a->insertNestedArray(name->name + "." + p->name->name, context);
-                }
-            }
-            else if (ty->isStructTy())
-            {
-                assert(is_ptr_of<RecordTypeNode>(p->type) || is_ptr_of<AliasTypeNode>(p->type));
-                if (is_ptr_of<RecordTypeNode>(p->type))
-                {
-                    auto recTy = cast_node<RecordTypeNode>(p->type);
-                    context.setRecordAlias(name->name + "." + p->name->name, recTy);
-                    recTy->insertNestedRecord(name->name + "." + p->name->name, context);
-                }
-                else
-                {
-                    std::string aliasName = cast_node<AliasTypeNode>(p->type)->name->name;
-                    std::shared_ptr<RecordTypeNode> recTy = nullptr;
-                    for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-                    {
-                        if ((recTy = context.getRecordAlias(*rit + "." + aliasName)) != nullptr)
-                            break;
-                    }
-                    if (recTy == nullptr) recTy = context.getRecordAlias(aliasName);
-                    if (recTy == nullptr) assert(0);
-                    context.setRecordAlias(name->name + "." + p->name->name, recTy);
-                    recTy->insertNestedRecord(name->name + "." + p->name->name, context);
-                }
-            }
         }
         llvm::Type *retTy = this->retType->getLLVMType(context);
         if (retTy == nullptr) throw CodegenException("Unsupported function return type");
         if (retTy->isArrayTy())
+            throw CodegenException("Not support array as function return type");
+        return llvm::FunctionType::get(retTy, types, false);
+    }
+
+    llvm::Function *RoutineNode::declare(CodegenContext &context)
+    {
+        auto *funcTy = getFunctionType(context);
+        auto *func = context.getModule()->getFunction(name->name);
+        if (func != nullptr)
         {
-            if (!retTy->getArrayElementType()->isIntegerTy(8) || retTy->getArrayNumElements() != 256)
-                throw CodegenException("Not support array as function return type");
-            retTy = context.getBuilder().getInt8PtrTy();
-            context.setArrayEntry(name->name + "." + name->name, 0, 255);
+            if (func->getFunctionType() != funcTy)
+                throw CodegenException("Routine does not match its declaration in the interface: " + name->name.str());
+            return func;
         }
-        else if (retTy->isStructTy())
+        func = llvm::Function::Create(funcTy, llvm::Function::ExternalLinkage, name->name, *context.getModule());
+        // Callers tell const from var params by these attributes, so declarations carry them too,
+        // those of routines imported from an interface file included
+        unsigned index = 0;
+        for (auto &p : params->getChildren())
         {
-            assert(is_ptr_of<RecordTypeNode>(this->retType) || is_ptr_of<AliasTypeNode>(this->retType));
-            if (is_ptr_of<RecordTypeNode>(this->retType))
+            auto *type = funcTy->getParamType(index);
+            if (type->isPointerTy() && !CodegenContext::isStringTy(type)) // by reference
             {
-                auto recTy = cast_node<RecordTypeNode>(this->retType);
-                context.setRecordAlias(name->name + "." + name->name, recTy);
-                recTy->insertNestedRecord(name->name + "." + name->name, context);
-            }
-            else
-            {
-                std::string aliasName = cast_node<AliasTypeNode>(this->retType)->name->name;
-                std::shared_ptr<RecordTypeNode> recTy = nullptr;
-                for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-                {
-                    if ((recTy = context.getRecordAlias(*rit + "." + aliasName)) != nullptr)
-                        break;
-                }
-                if (recTy == nullptr) recTy = context.getRecordAlias(aliasName);
-                if (recTy == nullptr) assert(0);
-                context.setRecordAlias(name->name + "." + name->name, recTy);
-                recTy->insertNestedRecord(name->name + "." + name->name, context);
+                func->addDereferenceableParamAttr(index, context.getModule()->getDataLayout().getTypeAllocSize(type->getPointerElementType()));
+                // not noalias: the argument may be a global the routine writes, or also passed as a var param
+                if (p->mode == ParamMode::ByConst)
+                    func->addParamAttr(index, llvm::Attribute::ReadOnly);
             }
+            index++;
         }
-        auto *funcTy = llvm::FunctionType::get(retTy, types, false);
-        auto *func = llvm::Function::Create(funcTy, llvm::Function::ExternalLinkage, name->name, *context.getModule());
+        return func;
+    }
+
+    llvm::Value *RoutineNode::codegen(CodegenContext &context)
+    {
+        context.log() << "Entering function " + name->name.str() << std::endl;
+
+        // only the unit itself may define the routines of its interface
+        if (context.getModule()->getFunction(name->name) != nullptr && !context.pendingRoutines.erase(name->name))
+            throw CodegenException("Duplicate function definition: " + name->name.str());
+
+        context.enterScope(name->name);
+        // Inclusive of nested routines, which are generated from inside this one
+        CompileReport::Scope routineScope(context.report, CompileReport::Routine, name->name);
+
+        std::vector<Symbol> names;
+        std::vector<ParamMode> modes;
+        for (auto &p : params->getChildren()) 
+        {
+            names.push_back(p->name->symbol);
+            modes.push_back(p->mode);
+            context.setVarType(p->name->symbol, p->type);
+        }
+        if (retType->type != Type::Void)
+            context.setVarType(name->symbol, retType);
+        // the definition of a routine declared in the interface of the unit fills in that declaration
+        auto *func = declare(context);
         auto *block = llvm::BasicBlock::Create(context.getModule()->getContext(), "entry", func);
         context.getBuilder().SetInsertPoint(block);
 
-        auto index = 0;
         for (auto &arg : func->args())
         {
+            auto index = arg.getArgNo();
             auto *type = arg.getType();
-            auto *local = context.getBuilder().CreateAlloca(type);
-            context.setLocal(name->name + "." + names[index++], local);
-            context.getBuilder().CreateStore(&arg, local);
+            llvm::Value *local;
+            if (type->isPointerTy() && !CodegenContext::isStringTy(type)) // by reference: the argument itself is the variable
+                local = &arg;
+            else
+            {
+                local = context.createEntryAlloca(type);
+                context.getBuilder().CreateStore(&arg, local);
+                // a const param cannot be assigned, the caller's reference keeps its strings alive
+                if (modes[index] != ParamMode::ByConst)
+                    context.retainStrings(local);
+            }
+            context.setLocal(names[index], local);
+            if (modes[index] == ParamMode::ByConst)
+                context.setConst(names[index], local);
         }
 
-        context.log() << "Entering const part of function " << name->name << std::endl;
+        context.log() << "Entering const part of function " << name->name.str() << std::endl;
         header->constList->codegen(context);
-        context.log() << "Entering type part of function " << name->name << std::endl;
+        context.log() << "Entering type part of function " << name->name.str() << std::endl;
         header->typeList->codegen(context);
-        context.log() << "Entering var part of function " << name->name << std::endl;
+        context.log() << "Entering var part of function " << name->name.str() << std::endl;
         header->varList->codegen(context);
+        // initializing the strings of the locals may have ended the entry block
+        auto *bodyBlock = context.getBuilder().GetInsertBlock();
 
-        context.log() << "Entering routine part of function " << name->name << std::endl;
+        context.log() << "Entering routine part of function " << name->name.str() << std::endl;
         header->subroutineList->codegen(context);
 
-        context.getBuilder().SetInsertPoint(block);
+        context.getBuilder().SetInsertPoint(bodyBlock);
         if (retType->type != Type::Void)  // set the return variable
         {  
             auto *type = retType->getLLVMType(context);
@@ -171,53 +244,36 @@ namespace spc
             llvm::Value *local;
             if (type == nullptr) throw CodegenException("Unknown function return type");
             else if (type->isArrayTy())
-            {
-                if (type->getArrayElementType()->isIntegerTy(8) && type->getArrayNumElements() == 256) // String
-                {
-                    local = context.getBuilder().CreateAlloca(type);
-                }
-                else
-                    throw CodegenException("Unknown function return type");
-            }
+                throw CodegenException("Unknown function return type");
             else
-                local = context.getBuilder().CreateAlloca(type);
+                local = context.createEntryAlloca(type);
             assert(local != nullptr && "Fatal error: Local variable alloc failed!");
-            context.setLocal(name->name + "." + name->name, local);
+            context.initStrings(local, false);
+            context.setLocal(name->symbol, local);
         }
 
-        context.log() << "Entering body part of function " << name->name << std::endl;
+        context.log() << "Entering body part of function " << name->name.str() << std::endl;
         body->codegen(context);
 
         if (retType->type != Type::Void) 
         {
-            auto *local = context.getLocal(name->name + "." + name->name);
+            auto *local = context.getLocal(name->symbol);
+            // a string result passes its reference to the caller
             llvm::Value *ret = context.getBuilder().CreateLoad(local);
-            if (ret->getType()->isArrayTy())
-            {
-                llvm::Value *tmpStr = context.getTempStrPtr();
-                llvm::Value *zero = llvm::ConstantInt::get(context.getBuilder().getInt32Ty(), 0, false);
-                llvm::Value *retPtr = context.getBuilder().CreateInBoundsGEP(local, {zero, zero});
-                context.log() << "\tSysfunc STRCPY" << std::endl;
-                context.getBuilder().CreateCall(context.strcpyFunc, {tmpStr, retPtr});
-                context.log() << "\tSTRING return" << std::endl;
-                context.getBuilder().CreateRet(tmpStr);
-            }
-            else
-                context.getBuilder().CreateRet(ret);
+            context.releaseLocals();
+            context.getBuilder().CreateRet(ret);
         } 
         else 
         {
+            context.releaseLocals();
             context.getBuilder().CreateRetVoid();
         }
 
         llvm::verifyFunction(*func, &llvm::errs());
 
-        if (context.fpm)
-            context.fpm->run(*func);
-
-        context.traces.pop_back();  
+        context.leaveScope();
 
-        context.log() << "Leaving function " << name->name << std::endl;
+        context.log() << "Leaving function " << name->name.str() << std::endl;
 
         return nullptr;
     }
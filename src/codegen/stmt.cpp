@@ -9,6 +9,7 @@ namespace spc
         auto *cond = expr->codegen(context);
         if (!cond->getType()->isIntegerTy(1))       
             throw CodegenException("Incompatible type in if condition: expected boolean");
+        context.releaseTemporaries();
 
         auto *func = context.getBuilder().GetInsertBlock()->getParent();
         auto *then_block = llvm::BasicBlock::Create(context.getModule()->getContext(), "then", func);
@@ -43,6 +44,7 @@ namespace spc
         auto *cond = expr->codegen(context);
         if (!cond->getType()->isIntegerTy(1))
         { throw CodegenException("Incompatible type in while condition: expected boolean"); }
+        context.releaseTemporaries();
         context.getBuilder().CreateCondBr(cond, loop_block, cont_block);
 
         context.getBuilder().SetInsertPoint(loop_block);
@@ -56,21 +58,43 @@ namespace spc
 
     llvm::Value *ForStmtNode::codegen(CodegenContext &context)
     {
-        if (!id->codegen(context)->getType()->isIntegerTy(32))
+        // Counted loop in rotated form: the bounds are evaluated once, the induction variable
+        // lives in a phi and is only stored to the loop variable for the body to read.
+        // The exit test compares against the bound before stepping, so "to maxint" terminates.
+        auto *var = id->getAssignPtr(context);
+        if (!var->getType()->getPointerElementType()->isIntegerTy(32))
             throw CodegenException("Incompatible type in for iterator: expected int");
-
-        auto init = make_node<AssignStmtNode>(id, init_val);
+        auto *start = init_val->codegen(context);
+        auto *end = end_val->codegen(context);
+        if (!start->getType()->isIntegerTy(32) || !end->getType()->isIntegerTy(32))
+            throw CodegenException("Incompatible type in for range: expected int");
+        context.releaseTemporaries();
         auto upto = direction == ForDirection::To;
-        auto cond = make_node<BinaryExprNode>(upto ? BinaryOp::Leq : BinaryOp::Geq, id, end_val);
-        auto iter = make_node<AssignStmtNode>(id,
-                make_node<BinaryExprNode>(upto ? BinaryOp::Plus :BinaryOp::Minus, id, make_node<IntegerNode>(1)));
-        auto compound = make_node<CompoundStmtNode>();
-        compound->merge(stmt); 
-        compound->append(iter);
-        auto while_stmt = make_node<WhileStmtNode>(cond, compound);
-
-        init->codegen(context);
-        while_stmt->codegen(context);
+
+        auto &builder = context.getBuilder();
+        auto *func = builder.GetInsertBlock()->getParent();
+        auto *preheader = builder.GetInsertBlock();
+        auto *body_block = llvm::BasicBlock::Create(context.getModule()->getContext(), "for", func);
+        auto *latch_block = llvm::BasicBlock::Create(context.getModule()->getContext(), "for_latch");
+        auto *cont_block = llvm::BasicBlock::Create(context.getModule()->getContext(), "cont");
+        auto *enter = upto ? builder.CreateICmpSLE(start, end) : builder.CreateICmpSGE(start, end);
+        builder.CreateCondBr(enter, body_block, cont_block);
+
+        builder.SetInsertPoint(body_block);
+        auto *iv = builder.CreatePHI(builder.getInt32Ty(), 2, id->name);
+        iv->addIncoming(start, preheader);
+        builder.CreateStore(iv, var);
+        stmt->codegen(context);
+        builder.CreateBr(latch_block);
+
+        func->getBasicBlockList().push_back(latch_block);
+        builder.SetInsertPoint(latch_block);
+        auto *next = upto ? builder.CreateNSWAdd(iv, builder.getInt32(1)) : builder.CreateNSWSub(iv, builder.getInt32(1));
+        iv->addIncoming(next, latch_block);
+        builder.CreateCondBr(builder.CreateICmpEQ(iv, end), cont_block, body_block);
+
+        func->getBasicBlockList().push_back(cont_block);
+        builder.SetInsertPoint(cont_block);
         return nullptr;
     }
 
@@ -85,6 +109,7 @@ namespace spc
         auto *cond = expr->codegen(context);
         if (!cond->getType()->isIntegerTy(1))
             throw CodegenException("Incompatible type in repeat condition: expected boolean");
+        context.releaseTemporaries();
         auto *cont = llvm::BasicBlock::Create(context.getModule()->getContext(), "cont", func);
         context.getBuilder().CreateCondBr(cond, cont, block);
 
@@ -94,7 +119,9 @@ namespace spc
 
     llvm::Value *ProcStmtNode::codegen(CodegenContext &context)
     {
-        return call->codegen(context);
+        call->codegen(context);
+        context.releaseTemporaries();
+        return nullptr;
     }
 
     llvm::Value *AssignStmtNode::codegen(CodegenContext &context)
@@ -108,43 +135,20 @@ namespace spc
         {
             rhs = context.getBuilder().CreateSIToFP(rhs, context.getBuilder().getDoubleTy());
         }
-        else if (lhs_type->isArrayTy())
+        else if (CodegenContext::isStringTy(lhs_type))
         {
-            if (!lhs_type->getArrayElementType()->isIntegerTy(8))
-                throw CodegenException("Cannot assign to a non-char array");
-            llvm::Value *zero = llvm::ConstantInt::getSigned(context.getBuilder().getInt32Ty(), 0);
-            llvm::Value *lhsPtr = context.getBuilder().CreateInBoundsGEP(lhs, {zero, zero});;
-            llvm::Value *rhsPtr;
-            if (rhs_type->isPointerTy())
-            {
-                context.log() << "\tString assign: call Sysfunc STRCPY" << std::endl;
-                if (rhs_type->getPointerElementType()->isArrayTy())
-                    rhsPtr = context.getBuilder().CreateInBoundsGEP(rhs, {zero, zero});
-                else
-                    rhsPtr = rhs;
-                context.getBuilder().CreateCall(context.strcpyFunc, {lhsPtr, rhsPtr});
-                return nullptr;
-            }
-            else if (rhs_type->isArrayTy())
-            {
-                context.log() << "\tString assign: Sysfunc SPRINTF" << std::endl;
-                context.log() << "\tString assign: call Sysfunc SPRINTF" << std::endl;
-                if (is_ptr_of<IdentifierNode>(this->rhs))
-                    rhsPtr = context.getBuilder().CreateInBoundsGEP(cast_node<IdentifierNode>(this->rhs)->getPtr(context), {zero, zero});
-                else if (is_ptr_of<RecordRefNode>(this->rhs))
-                    rhsPtr = cast_node<RecordRefNode>(this->rhs)->getPtr(context);
-                else if (is_ptr_of<CustomProcNode>(this->rhs))
-                    rhsPtr = context.getBuilder().CreateInBoundsGEP(rhs, {zero, zero});
-                if (!rhs_type->getArrayElementType()->isIntegerTy(8))
-                    throw CodegenException("Cannot assign to a non-char array");
-                context.getBuilder().CreateCall(context.sprintfFunc, {lhsPtr, context.getBuilder().CreateGlobalStringPtr("%s"), rhsPtr});
-                return nullptr;
-            }
+            if (!CodegenContext::isStringTy(rhs_type))
+                throw CodegenException("Incompatible type in assignment: expected string");
+            context.log() << "\tString assign" << std::endl;
+            context.assignString(lhs, rhs);
+            context.releaseTemporaries();
+            return nullptr;
         }
         else if (lhs_type->isDoubleTy() && rhs_type->isIntegerTy())
         {
             auto *rhsFP = context.getBuilder().CreateSIToFP(rhs, lhs_type);
             context.getBuilder().CreateStore(rhsFP, lhs);
+            context.releaseTemporaries();
             return nullptr;
         }
         else if (lhs_type->isIntegerTy(32) && rhs_type->isDoubleTy())
@@ -152,15 +156,16 @@ namespace spc
             auto *rhsSI = context.getBuilder().CreateFPToSI(rhs, lhs_type);
             std::cerr << "Warning: Assigning REAL type to INTEGER type, this may lose information" << std::endl;
             context.getBuilder().CreateStore(rhsSI, lhs);
+            context.releaseTemporaries();
             return nullptr;
         }
         if (!((lhs_type->isIntegerTy(1) && rhs_type->isIntegerTy(1))  // bool
                    || (lhs_type->isIntegerTy(32) && rhs_type->isIntegerTy(32))  // int
                    || (lhs_type->isIntegerTy(8) && rhs_type->isIntegerTy(8))  // char
-                   || (lhs_type->isDoubleTy() && rhs_type->isDoubleTy()) // float
-                   || (lhs_type->isArrayTy() && rhs_type->isIntegerTy(32)))) // string
+                   || (lhs_type->isDoubleTy() && rhs_type->isDoubleTy()))) // float
             throw CodegenException("Incompatible type in assignment");
         context.getBuilder().CreateStore(rhs, lhs);
+        context.releaseTemporaries();
         return nullptr;
     }
 
@@ -169,6 +174,7 @@ namespace spc
         auto *value = expr->codegen(context);
         if (!value->getType()->isIntegerTy())
             throw CodegenException("Incompatible type in case statement: expected char, integer");
+        context.releaseTemporaries();
         auto *func = context.getBuilder().GetInsertBlock()->getParent();
         auto *cont = llvm::BasicBlock::Create(context.getModule()->getContext(), "cont");
         auto *switch_inst = context.getBuilder().CreateSwitch(value, cont, static_cast<unsigned int>(branches.size()));
@@ -178,7 +184,7 @@ namespace spc
             if (is_ptr_of<ConstValueNode>(branch->branch))
                 constant = llvm::cast<llvm::ConstantInt>(branch->branch->codegen(context));
             else // ID node
-                constant = context.getConstInt(cast_node<IdentifierNode>(branch->branch)->name);
+                constant = context.findConstInt(cast_node<IdentifierNode>(branch->branch)->symbol);
             auto *block = llvm::BasicBlock::Create(context.getModule()->getContext(), "case", func);
             context.getBuilder().SetInsertPoint(block);
             branch->stmt->codegen(context);
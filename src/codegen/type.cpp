@@ -19,121 +19,75 @@ namespace spc
 
     llvm::Type *AliasTypeNode::getLLVMType(CodegenContext &context) 
     {
-        if (context.is_subroutine)
-        {
-            for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-            {
-                llvm::Type *ret = nullptr;
-                if ((ret = context.getAlias(*rit + "." + name->name)) != nullptr)
-                    return ret;
-            }
-        }
-        llvm::Type *ret = context.getAlias(name->name);
-        if (ret == nullptr)
-            throw CodegenException("Undefined alias in function " + context.getTrace() + ": " + name->name);
-        return ret;
+        if (llvmType != nullptr)
+            return llvmType;
+        llvmType = context.findAlias(name->symbol);
+        if (llvmType == nullptr)
+            throw CodegenException("Undefined alias in function " + context.getTrace() + ": " + name->name.str());
+        if ((target = context.findArrayAlias(name->symbol)) == nullptr)
+            target = context.findRecordAlias(name->symbol);
+        return llvmType;
+    }
+
+    TypeNode *AliasTypeNode::resolve(CodegenContext &context)
+    {
+        getLLVMType(context);
+        return target != nullptr ? target : this;
     }
 
     llvm::Type *StringTypeNode::getLLVMType(CodegenContext &context)
     {
-        return llvm::ArrayType::get(context.getBuilder().getInt8Ty(), 256);
-        // return nullptr;
+        return context.getStringTy();
     }
 
-    llvm::Type *ArrayTypeNode::getLLVMType(CodegenContext &context)
+    const std::pair<int, int> &ArrayTypeNode::getRange(CodegenContext &context)
     {
-        auto st = this->range_start->codegen(context),
-             ed = this->range_end->codegen(context);
-        int s = llvm::cast<llvm::ConstantInt>(st)->getSExtValue(), 
-            e = llvm::cast<llvm::ConstantInt>(ed)->getSExtValue();
+        if (hasRange)
+            return range;
+        auto *st = llvm::dyn_cast<llvm::ConstantInt>(this->range_start->codegen(context));
+        if (st == nullptr)
+            throw CodegenException("Start index invalid");
+        auto *ed = llvm::dyn_cast<llvm::ConstantInt>(this->range_end->codegen(context));
+        if (ed == nullptr)
+            throw CodegenException("End index invalid");
+        if (st->getBitWidth() > 32 || ed->getBitWidth() > 32)
+            throw CodegenException("End index overflow");
+        int s = st->getSExtValue(), e = ed->getSExtValue();
         if (e < s)
             throw CodegenException("End index must be greater than start index!");
-        return llvm::ArrayType::get(this->itemType->getLLVMType(context), e - s + 1);
+        range = std::make_pair(s, e);
+        hasRange = true;
+        return range;
     }
 
-    void ArrayTypeNode::insertNestedArray(const std::string &outer, CodegenContext &context)
+    llvm::Type *ArrayTypeNode::getLLVMType(CodegenContext &context)
     {
-        std::shared_ptr<ArrayTypeNode> a;
-        std::shared_ptr<RecordTypeNode> rec;
-        std::string aliasName;
-        switch (itemType->type)
-        {
-        case Type::Alias:
-            aliasName = cast_node<AliasTypeNode>(itemType)->name->name;
-            for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-                if ((a = context.getArrayAlias(*rit + "." + aliasName)) != nullptr)
-                    break;
-            if (a == nullptr) a = context.getArrayAlias(aliasName);
-            if (a != nullptr)
-            {
-                if (!context.setArrayEntry(outer + "[]", a)) throw CodegenException("Duplicate nested array field!");
-                a->insertNestedArray(outer + "[]", context);
-                break;
-            }
-            for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-                if ((rec = context.getRecordAlias(*rit + "." + aliasName)) != nullptr)
-                    break;
-            if (rec == nullptr) rec = context.getRecordAlias(aliasName);
-            if (rec == nullptr) break;
-            if (!context.setRecordAlias(outer + "[]", rec)) throw CodegenException("Duplicate nested record field!");
-            rec->insertNestedRecord(outer + "[]", context);
-            break;
-        case Type::String:
-            if (!context.setArrayEntry(outer + "[]", 0, 255)) throw CodegenException("Duplicate nested array field!");
-            break;
-        case Type::Array:
-            a = cast_node<ArrayTypeNode>(itemType);
-            assert(a != nullptr);
-            if (!context.setArrayEntry(outer + "[]", a)) throw CodegenException("Duplicate nested array field!");
-            a->insertNestedArray(outer + "[]", context);
-            break;
-        case Type::Record:
-            rec = cast_node<RecordTypeNode>(itemType);
-            if (!context.setRecordAlias(outer + "[]", rec)) throw CodegenException("Duplicate nested record field!");
-            rec->insertNestedRecord(outer + "[]", context);
-            break;
-        default:
-            break;
-        }
+        if (llvmType != nullptr)
+            return llvmType;
+        auto &r = getRange(context);
+        llvmType = llvm::ArrayType::get(this->itemType->getLLVMType(context), r.second - r.first + 1);
+        return llvmType;
     }
 
-    void RecordTypeNode::append(const std::shared_ptr<VarDeclNode> &var)
+
+    void RecordTypeNode::append(VarDeclNode *var)
     {
-        for (auto &f : field)
-        {
-            if (f->name->name == var->name->name)
-                throw std::logic_error("Duplicate name \'" + f->name->name + "\' in record field declare!");
-        }
+        if (!fieldIdx.emplace(var->name->symbol, field.size()).second)
+            throw std::logic_error("Duplicate name \'" + var->name->name.str() + "\' in record field declare!");
         field.push_back(var);
     }
-    void RecordTypeNode::merge(const std::shared_ptr<RecordTypeNode> &rhs)
+    void RecordTypeNode::merge(RecordTypeNode *rhs)
     {
         for (auto &var : rhs->field)
         {
-            field.push_back(var);
-        }
-        // Check duplicate
-        std::set<std::string> nameSet;
-        for (auto &f : field)
-        {
-            if (!nameSet.insert(f->name->name).second)
-                throw std::logic_error("Duplicate name \'" + f->name->name + "\' in record field declare!");
-        }
-    }
-    void RecordTypeNode::merge(std::shared_ptr<RecordTypeNode> &&rhs)
-    {
-        field.merge(std::move(rhs->field));
-        // Check duplicate
-        std::set<std::string> nameSet;
-        for (auto &f : field)
-        {
-            if (!nameSet.insert(f->name->name).second)
-                throw std::logic_error("Duplicate name \'" + f->name->name + "\' in record field declare!");
+            append(var);
         }
     }
 
     llvm::Type *RecordTypeNode::getLLVMType(CodegenContext &context)
     { 
+        if (llvmType != nullptr)
+            return llvmType;
         std::vector<llvm::Type *> fieldTy;
         for (auto &decl: field)
         {
@@ -142,70 +96,23 @@ namespace spc
                 throw CodegenException("Unsupported type in record declaration");
             fieldTy.push_back(ty);
         }
-        return llvm::StructType::get(context.getBuilder().getContext(), fieldTy);
+        llvmType = llvm::StructType::get(context.getBuilder().getContext(), fieldTy);
+        return llvmType;
     }
-    void RecordTypeNode::insertNestedRecord(const std::string &outer, CodegenContext &context)
+
+    TypeNode *RecordTypeNode::getFieldType(Symbol name)
     {
-        for (auto &f : this->field)
-        {
-            auto fTy = f->type;
-            std::string fName = f->name->name;
-            if (fTy->type == Type::Alias)
-            {
-                std::shared_ptr<RecordTypeNode> rec;
-                std::shared_ptr<ArrayTypeNode> a;
-                std::string aliasName = cast_node<AliasTypeNode>(fTy)->name->name;
-                for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-                    if ((rec = context.getRecordAlias(*rit + "." + aliasName)) != nullptr)
-                        break;
-                if (rec == nullptr) rec = context.getRecordAlias(aliasName);
-                if (rec != nullptr)
-                {
-                    if (!context.setRecordAlias(outer + "." + fName, rec)) throw CodegenException("Duplicate nested record field!");
-                    rec->insertNestedRecord(outer + "." + fName, context);
-                    continue;
-                }
-                for (auto rit = context.traces.rbegin(); rit != context.traces.rend(); rit++)
-                if ((a = context.getArrayAlias(*rit + "." + aliasName)) != nullptr)
-                    break;
-                if (a == nullptr) a = context.getArrayAlias(aliasName);
-                if (a == nullptr) continue;
-                assert(a != nullptr);
-                if (!context.setArrayEntry(outer + "." + fName, a)) throw CodegenException("Duplicate nested array field!");
-                a->insertNestedArray(outer + "." + fName, context);
-            }
-            else if (fTy->type == Type::String)
-            {
-                if (!context.setArrayEntry(outer + "." + fName, 0, 255)) throw CodegenException("Duplicate nested record field!");
-            }
-            else if (fTy->type == Type::Record)
-            {
-                std::shared_ptr<RecordTypeNode> rec = cast_node<RecordTypeNode>(fTy);
-                if (!context.setRecordAlias(outer + "." + fName, rec)) throw CodegenException("Duplicate nested record field!");
-                rec->insertNestedRecord(outer + "." + fName, context);
-            }
-            else if (fTy->type == Type::Array)
-            {
-                std::shared_ptr<ArrayTypeNode> arr = cast_node<ArrayTypeNode>(fTy);
-                assert(arr != nullptr);
-                if (!context.setArrayEntry(outer + "." + fName, arr)) throw CodegenException("Duplicate nested record field!");
-                arr->insertNestedArray(outer + "." + fName, context);
-            }
-        }
-        
+        auto it = fieldIdx.find(name);
+        return it == fieldIdx.end() ? nullptr : field[it->second]->type;
     }
 
-    llvm::Value *RecordTypeNode::getFieldIdx(const std::string &name, CodegenContext &context)
+    llvm::Value *RecordTypeNode::getFieldIdx(Symbol name, CodegenContext &context)
     {
-        unsigned i = 0;
-        for (auto &f : field)
-        {
-            if (f->name->name == name)
-                return llvm::ConstantInt::get(context.getBuilder().getInt32Ty(), i, false);
-            ++i;
-        }
-        // throw CodegenException("Unknown name in record field");
-        return nullptr;
+        auto it = fieldIdx.find(name);
+        if (it == fieldIdx.end())
+            // throw CodegenException("Unknown name in record field");
+            return nullptr;
+        return llvm::ConstantInt::get(context.getBuilder().getInt32Ty(), it->second, false);
     }
 
     llvm::Type *ConstValueNode::getLLVMType(CodegenContext &context)
@@ -217,7 +124,7 @@ namespace spc
             case Type::Long: return context.getBuilder().getInt32Ty();
             case Type::Char: return context.getBuilder().getInt8Ty();
             case Type::Real: return context.getBuilder().getDoubleTy();
-            case Type::String: throw CodegenException("String currently not supported.");
+            case Type::String: return context.getStringTy();
             default: throw CodegenException("Unknown type!"); return nullptr;
         }
         return nullptr;
@@ -248,16 +155,7 @@ namespace spc
 
     llvm::Value *StringNode::codegen(CodegenContext &context) 
     {
-        llvm::Module *M = context.getModule().get();
-        llvm::LLVMContext& ctx = M->getContext();
-        llvm::Constant *strConstant = llvm::ConstantDataArray::getString(ctx, val);
-        llvm::Type *t = strConstant->getType();
-        llvm::GlobalVariable *GVStr = new llvm::GlobalVariable(*M, t, true, llvm::GlobalValue::ExternalLinkage, strConstant, "");
-        llvm::Constant* zero = llvm::Constant::getNullValue(llvm::IntegerType::getInt32Ty(ctx));
-
-        llvm::Constant *strVal = llvm::ConstantExpr::getGetElementPtr(t, GVStr, zero, true);
-
-        return strVal;
+        return context.getStringLiteral(val);
     }
 
     llvm::Type *VoidTypeNode::getLLVMType(CodegenContext &context)
@@ -0,0 +1,218 @@
+#include "compilation.hpp"
+#include "utils/ASTvis.hpp"
+#include "utils/ASTopt.hpp"
+#include "utils/source_buffer.hpp"
+#include "utils/unit_interface.hpp"
+#include "parser.hpp"
+
+#include <cctype>
+#include <stdexcept>
+
+// Generated by flex (%option reentrant)
+typedef struct yy_buffer_state *YY_BUFFER_STATE;
+int yylex_init(yyscan_t *scanner);
+int yylex_destroy(yyscan_t scanner);
+YY_BUFFER_STATE yy_scan_buffer(char *base, size_t size, yyscan_t scanner);
+
+namespace spc
+{
+
+    void Compilation::parse()
+    {
+        CompileReport::Scope scope(report, CompileReport::Phase, "Parsing");
+        ASTArena::Scope arenaScope(arena);
+        // Scanned in place, flex never copies the source into buffers of its own
+        SourceBuffer source;
+        source.open(input);
+        if (report != nullptr) report->setInputBytes(source.size());
+
+        yyscan_t scanner;
+        yylex_init(&scanner);
+        // The buffer is freed with the scanner by yylex_destroy; the memory stays owned by source
+        yy_scan_buffer(source.data(), source.scanSize(), scanner);
+        parser pars(scanner, program);
+        try
+        {
+            pars.parse();
+        }
+        catch (...)
+        {
+            yylex_destroy(scanner);
+            throw;
+        }
+        yylex_destroy(scanner);
+        if (report != nullptr) report->setASTBytes(arena.getBytesAllocated());
+    }
+
+    void Compilation::optimizeAST()
+    {
+        CompileReport::Scope scope(report, CompileReport::Phase, "AST optimization");
+        ASTArena::Scope arenaScope(arena);
+        ASTopt astOpt;
+        astOpt(program);
+    }
+
+    void Compilation::visualizeAST(const std::string &output)
+    {
+        CompileReport::Scope scope(report, CompileReport::Phase, "AST visualization");
+        ASTvis astVis(output);
+        astVis.travAST(program);
+    }
+
+    std::vector<std::string> Compilation::getUses() const
+    {
+        std::vector<std::string> uses;
+        auto append = [&](IdentifierList *list)
+        {
+            for (auto *use : list->getChildren())
+                uses.push_back(use->name);
+        };
+        if (auto *unit = cast_node<UnitNode>(program))
+        {
+            append(unit->getInterfaceUses());
+            append(unit->getImplementationUses());
+        }
+        else
+            append(cast_node<ProgramNode>(program)->getUses());
+        return uses;
+    }
+
+    // Tokens of a source as far as scanUses needs them: lower-cased identifiers and keywords,
+    // and single chars. Comments, strings and whitespace are skipped like the scanner does.
+    class UsesScanner
+    {
+    private:
+        const char *pos, *end;
+    public:
+        UsesScanner(const char *begin, size_t size) : pos(begin), end(begin + size) {}
+
+        // The next token, "" at the end of the source
+        std::string next()
+        {
+            while (pos < end)
+            {
+                char c = *pos;
+                if (std::isspace(static_cast<unsigned char>(c)))
+                    pos++;
+                else if (c == '{')
+                    skipPast(1, "}");
+                else if (c == '(' && pos + 1 < end && pos[1] == '*')
+                    skipPast(2, "*)");
+                else if (c == '/' && pos + 1 < end && pos[1] == '/')
+                    skipPast(2, "\n");
+                else if (c == '\'')
+                    skipPast(1, "'"); // '' inside a string is two strings in a row here, which skips the same chars
+                else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+                {
+                    std::string word;
+                    for (; pos < end && (std::isalnum(static_cast<unsigned char>(*pos)) || *pos == '_'); pos++)
+                        word.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(*pos))));
+                    return word;
+                }
+                else
+                    return std::string(1, *pos++);
+            }
+            return "";
+        }
+
+    private:
+        // Skips the opening chars, then everything up to and including delim
+        void skipPast(size_t open, llvm::StringRef delim)
+        {
+            auto rest = llvm::StringRef(pos, end - pos).drop_front(open);
+            auto found = rest.find(delim);
+            pos = found == llvm::StringRef::npos ? end : rest.data() + found + delim.size();
+        }
+    };
+
+    // uses a, b; after the current token, which is read first
+    static bool scanUsesClause(UsesScanner &scanner, std::string &token, std::vector<std::string> &uses)
+    {
+        token = scanner.next();
+        if (token != "uses")
+            return true;
+        do
+        {
+            token = scanner.next();
+            if (token.empty() || !(std::isalpha(static_cast<unsigned char>(token[0])) || token[0] == '_'))
+                return false;
+            uses.push_back(token);
+            token = scanner.next();
+        } while (token == ",");
+        if (token != ";")
+            return false;
+        token = scanner.next();
+        return true;
+    }
+
+    bool Compilation::scanUses(const std::string &input, bool &isUnit, std::vector<std::string> &uses)
+    {
+        SourceBuffer source;
+        try
+        {
+            source.open(input);
+        }
+        catch (const std::runtime_error &)
+        {
+            return false;
+        }
+        UsesScanner scanner(source.data(), source.size());
+        std::string token = scanner.next();
+        isUnit = token == "unit";
+        if (!isUnit && token != "program")
+            return false;
+        scanner.next();
+        if (scanner.next() != ";")
+            return false;
+        if (!isUnit)
+            return scanUsesClause(scanner, token, uses);
+        if (scanner.next() != "interface" || !scanUsesClause(scanner, token, uses))
+            return false;
+        // a keyword, so its first occurrence ends the interface
+        while (token != "implementation")
+        {
+            if (token.empty())
+                return false;
+            token = scanner.next();
+        }
+        return scanUsesClause(scanner, token, uses);
+    }
+
+    bool Compilation::writeInterface(const std::string &path, std::string &error)
+    {
+        return UnitInterface::write(cast_node<UnitNode>(program), path, error);
+    }
+
+    void Compilation::codegen(const std::string &logFile, const std::vector<std::string> &unitPath)
+    {
+        CompileReport::Scope scope(report, CompileReport::Phase, "Code generation");
+        genContext = std::make_unique<CodegenContext>("main", *llvmContext, logFile);
+        genContext->report = report;
+        genContext->unitPath = unitPath;
+        // reading a used unit's interface file builds its declarations as nodes
+        ASTArena::Scope arenaScope(arena);
+        try
+        {
+            program->codegen(*genContext);
+        }
+        catch (CodegenException &)
+        {
+            if (genContext->log().is_open()) genContext->log().close();
+            throw;
+        }
+    }
+
+    void Compilation::optimize(llvm::TargetMachine &tm, const OptimizeOptions &options)
+    {
+        CompileReport::Scope scope(report, CompileReport::Phase, "LLVM optimization");
+        optimizeModule(*genContext->getModule(), tm, options);
+    }
+
+    llvm::orc::ThreadSafeModule Compilation::takeModule()
+    {
+        std::unique_ptr<llvm::Module> module = std::move(genContext->getModule());
+        genContext.reset();
+        return llvm::orc::ThreadSafeModule(std::move(module), std::move(llvmContext));
+    }
+
+} // namespace spc
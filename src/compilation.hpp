@@ -0,0 +1,68 @@
+#ifndef COMPILATION_H
+#define COMPILATION_H
+
+#include "utils/ast.hpp"
+#include "codegen/codegen_context.hpp"
+#include "codegen/optimizer.hpp"
+
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace spc
+{
+    // Everything one source file needs from scanning to codegen.
+    // Nothing is shared between two Compilations, so they may run on different threads.
+    class Compilation
+    {
+    private:
+        std::string input;
+        // declared first so that it outlives the module inside genContext
+        std::unique_ptr<llvm::LLVMContext> llvmContext;
+        // owns every AST node; program and the codegen tables only point into it
+        ASTArena arena;
+        // a ProgramNode or a UnitNode
+        BaseRoutineNode *program = nullptr;
+        std::unique_ptr<CodegenContext> genContext;
+        // Phases are recorded into report when it is not null
+        CompileReport *report;
+    public:
+        explicit Compilation(const std::string &input, CompileReport *report = nullptr)
+            : input(input), llvmContext(std::make_unique<llvm::LLVMContext>()), report(report) {}
+        ~Compilation() = default;
+
+        // Throws std::runtime_error if the file cannot be opened,
+        // std::invalid_argument on scanning errors and std::logic_error on parsing errors
+        void parse();
+        void optimizeAST();
+        void visualizeAST(const std::string &output);
+        // Interface files of used units are searched in unitPath. Throws CodegenException
+        void codegen(const std::string &logFile = "compile.log", const std::vector<std::string> &unitPath = {});
+        // Runs the standard LLVM pipeline, tuned for tm, over the generated module.
+        // Throws std::runtime_error if the options do not fit the target.
+        void optimize(llvm::TargetMachine &tm, const OptimizeOptions &options);
+
+        // Hands the module, together with the LLVMContext it lives in, over to the caller (e.g. a JIT).
+        // The codegen context is released, so this must be the last step of the compilation.
+        llvm::orc::ThreadSafeModule takeModule();
+
+        const std::string &getInput() const { return input; }
+        BaseRoutineNode *&getProgram() { return program; }
+        bool isUnit() const { return is_ptr_of<UnitNode>(program); }
+        // Units named by the uses clauses of the parsed source
+        std::vector<std::string> getUses() const;
+        // Finds the kind of source and the units its uses clauses name by skimming the tokens of input,
+        // without parsing it, so that the compile cache can be looked up before parsing.
+        // Returns false if input cannot be read or does not start like a program or a unit.
+        static bool scanUses(const std::string &input, bool &isUnit, std::vector<std::string> &uses);
+        // Writes the interface file of a parsed unit. Returns false and sets error on failure.
+        bool writeInterface(const std::string &path, std::string &error);
+        llvm::LLVMContext &getLLVMContext() { return *llvmContext; }
+        ASTArena &getArena() { return arena; }
+        CodegenContext &getCodegenContext() { return *genContext; }
+    };
+
+} // namespace spc
+
+#endif
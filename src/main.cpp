@@ -3,185 +3,374 @@
 #include <cstring>
 #include <string>
 #include <utility>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <functional>
 
-#include "llvm/Support/FileSystem.h"
-#include "llvm/Support/Host.h"
-#include "llvm/Support/TargetSelect.h"
-#include "llvm/Support/TargetRegistry.h"
-#include "llvm/Support/raw_ostream.h"
-#include "llvm/Target/TargetMachine.h"
-#include "llvm/ADT/APFloat.h"
-#include "llvm/ADT/STLExtras.h"
-#include "llvm/IR/BasicBlock.h"
-#include "llvm/IR/Constants.h"
-#include "llvm/IR/DerivedTypes.h"
-#include "llvm/IR/Function.h"
-#include "llvm/IR/IRBuilder.h"
-#include "llvm/ADT/STLExtras.h"
-#include "llvm/IR/LLVMContext.h"
-#include "llvm/IR/Module.h"
-#include "llvm/IR/Type.h"
-#include "llvm/IR/Verifier.h"
-#include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
-#include "utils/ast.hpp"
-#include "utils/ASTvis.hpp"
-#include "utils/ASTopt.hpp"
-#include "codegen/codegen_context.hpp"
-#include "parser.hpp"
+#include <llvm/ADT/APFloat.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include <llvm/Pass.h>
+#include <llvm/Support/Timer.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/Path.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include "compilation.hpp"
+#include "utils/cache.hpp"
+#include "utils/unit_interface.hpp"
 
-extern FILE *yyin;
-std::shared_ptr<spc::ProgramNode> program;
+enum Target { UNDEFINED, LLVM, ASM, OBJ, BC, RUN };
 
-void emit_target(llvm::raw_fd_ostream &dest, llvm::TargetMachine::CodeGenFileType type, llvm::Module &module)
+struct Options
+{
+    Target target = Target::UNDEFINED;
+    // -O<level>, -print-pipeline, -fmultiversion=, -fprofile-generate, -fprofile-use=
+    spc::OptimizeOptions optimize;
+    // -march=, -mcpu=, -mattr=
+    spc::TargetConfig targetConfig;
+    bool optAst = false;
+    // -lto: link the inputs (.bc/.ll) into one program instead of compiling them
+    bool lto = false;
+    // -I: directories searched for the interface files of used units
+    std::vector<std::string> unitPath;
+    bool printTable = false;
+    bool printLLVM = false;
+    bool time = false;
+    // -ftime-report / -fmem-report / -freport-json=<file>
+    bool timeReport = false, memReport = false;
+    std::string reportJSON;
+    // --cache-dir; shared by all compilations of one run
+    spc::CompileCache *cache = nullptr;
+    // progress messages of each phase; off when compiling several files at once
+    bool verbose = true;
+    std::string logFile = "compile.log";
+};
+
+// Serializes everything printed to stdout while compilations run in parallel
+static std::mutex outputMutex;
+
+void init_targets()
 {
     llvm::InitializeAllTargetInfos();
     llvm::InitializeAllTargets();
     llvm::InitializeAllTargetMCs();
     llvm::InitializeAllAsmParsers();
     llvm::InitializeAllAsmPrinters();
+}
 
-    auto target_triple = llvm::sys::getDefaultTargetTriple();
-    module.setTargetTriple(target_triple);
-
-    std::string error;
-    auto target = llvm::TargetRegistry::lookupTarget(target_triple, error);
-    if (!target)
-    { llvm::errs() << error; exit(1); }
-
-    auto cpu = "generic";
-    auto features = "";
-    llvm::TargetOptions opt;
-    auto rm = llvm::Optional<llvm::Reloc::Model>();
-    auto target_machine = target->createTargetMachine(target_triple, cpu, features, opt, rm);
-    module.setDataLayout(target_machine->createDataLayout());
-
+// The module's triple and data layout must already be those of target_machine
+bool emit_target(llvm::raw_fd_ostream &dest, llvm::TargetMachine::CodeGenFileType type, llvm::Module &module, llvm::TargetMachine &target_machine, std::string &error)
+{
     llvm::legacy::PassManager pass;
-    if (target_machine->addPassesToEmitFile(pass, dest, nullptr, type))
+    if (target_machine.addPassesToEmitFile(pass, dest, nullptr, type))
     {
-        llvm::errs() << "The target machine cannot emit an object file";
-        exit(1);
+        error = "The target machine cannot emit an object file";
+        return false;
     }
 
     llvm::verifyModule(module, &llvm::errs());
     pass.run(module);
 
     dest.flush();
+    return true;
 }
 
-int main(int argc, char* argv[])
+// Writes module to dest in the format of target, which must not be RUN
+bool emit_module(llvm::raw_fd_ostream &dest, Target target, llvm::Module &module, llvm::TargetMachine &target_machine, std::string &error)
 {
-    enum Target { UNDEFINED, LLVM, ASM, OBJ };
+    switch (target)
+    {
+        case Target::LLVM: module.print(dest, nullptr); break;
+        case Target::BC: llvm::WriteBitcodeToFile(module, dest); break;
+        case Target::ASM: return emit_target(dest, llvm::TargetMachine::CGFT_AssemblyFile, module, target_machine, error);
+        case Target::OBJ: return emit_target(dest, llvm::TargetMachine::CGFT_ObjectFile, module, target_machine, error);
+        default: break;
+    }
+    return true;
+}
 
-    Target target = Target::UNDEFINED;
-    char *input = nullptr, *outputP = nullptr;
-    bool opt = false, optAst = false;
-    bool printTable = false;
-    bool printLLVM = false;
+using Clock = std::chrono::steady_clock;
 
-    for (int i = 1; i < argc; ++i)
+static double elapsed_ms(Clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+// Runs main() of the module in-process. libc and libspcrt symbols resolve against the spc process itself.
+bool run_jit(llvm::orc::ThreadSafeModule module, const Options &options, Clock::time_point start, int &exitCode, std::string &error, spc::CompileReport *report)
+{
+    auto compiled = Clock::now();
+    std::unique_ptr<spc::CompileReport::Scope> jitScope(new spc::CompileReport::Scope(report, spc::CompileReport::Phase, "JIT compilation"));
+    auto jit = llvm::orc::LLJITBuilder().create();
+    if (!jit)
     {
-        if (strcmp(argv[i], "-ir") == 0) target = Target::LLVM;
-        else if (strcmp(argv[i], "-S") == 0) target = Target::ASM;
-        else if (strcmp(argv[i], "-c") == 0) target = Target::OBJ;
-        else if (strcmp(argv[i], "-O") == 0) opt = true;
-        else if (strcmp(argv[i], "-opt-ast") == 0) optAst = true;
-        else if (strcmp(argv[i], "-print-table") == 0) printTable = true;
-        else if (strcmp(argv[i], "-print-llvm") == 0) printLLVM = true;
-        else if (strcmp(argv[i], "-o") == 0)
-        {
-            if (i == argc - 1) 
-            {
-                std::cerr << "Error: unspecified output file" << std::endl;
-                exit(1);
-            }
-            outputP = argv[++i];
-        }
-        else if (argv[i][0] == '-')
-        { 
-            fprintf(stderr, "Error: unknown argument: %s", argv[i]); 
-            exit(1); 
-        }
-        else input = argv[i];
+        error = "Failed to create JIT: " + llvm::toString(jit.takeError());
+        return false;
     }
-    if (target == Target::UNDEFINED || input == nullptr)
+    auto &dl = (*jit)->getDataLayout();
+    auto generator = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(dl.getGlobalPrefix());
+    if (!generator)
     {
-        puts("USAGE: spc <option> <input file>");
-        puts("OPTION:");
-        puts("  -ir                  Emit LLVM assembly code (.ll)");
-        puts("  -S                   Emit assembly code (.s)");
-        puts("  -c                   Emit object code (.o)");
-        puts(" [-o <output file>]    Specify output file");
-        puts(" [-O]                  Enable LLVM optimizations");
-        puts(" [-opt-ast]            Enable AST optimizations");
-        puts(" [-print-table]        Print the symbol table");
-        puts(" [-print-llvm]         Print the LLVM IR");
-        exit(1);
+        error = "Failed to load process symbols: " + llvm::toString(generator.takeError());
+        return false;
     }
+    (*jit)->getMainJITDylib().setGenerator(std::move(*generator));
 
-    if ((yyin = fopen(input, "r")) == nullptr)
+    // addIRModule applies the JIT's data layout to the module
+    if (auto err = (*jit)->addIRModule(std::move(module)))
     {
-        std::cerr << "Error: cannot open iutput file" << std::endl;
-        exit(1);
+        error = "Failed to add module to JIT: " + llvm::toString(std::move(err));
+        return false;
+    }
+    // The lookup materializes (compiles) the module
+    auto mainSym = (*jit)->lookup("main");
+    if (!mainSym)
+    {
+        error = "Failed to look up main: " + llvm::toString(mainSym.takeError());
+        return false;
+    }
+    auto *mainFunc = reinterpret_cast<int (*)()>(mainSym->getAddress());
+    jitScope.reset();
+
+    if (options.time)
+    {
+        std::cerr << std::fixed << std::setprecision(3);
+        std::cerr << "[time] frontend & codegen:        " << std::chrono::duration<double, std::milli>(compiled - start).count() << " ms" << std::endl;
+        std::cerr << "[time] JIT compile:               " << elapsed_ms(compiled) << " ms" << std::endl;
+        std::cerr << "[time] compile to entry:          " << elapsed_ms(start) << " ms" << std::endl;
+    }
+    auto running = Clock::now();
+    exitCode = mainFunc();
+    fflush(stdout);
+    if (options.time)
+        std::cerr << "[time] run:                       " << elapsed_ms(running) << " ms" << std::endl;
+    return true;
+}
+
+std::string get_output_name(const std::string &input, const char *outputP, Target target)
+{
+    std::string output;
+    if (outputP == nullptr)
+        output = input;
+    else
+        output = outputP;
+    output.erase(output.rfind('.'));
+    switch (target)
+    {
+        case Target::LLVM: output.append(".ll"); break;
+        case Target::ASM:  output.append(".s");  break;
+        case Target::OBJ:  output.append(".o");  break;
+        case Target::BC:   output.append(".bc"); break;
+        default: break;
     }
+    return output;
+}
+
+// Everything besides the source that changes the output of a compilation
+static std::string cache_flags(const Options &options)
+{
+    std::string flags = std::to_string(options.target) + " -" + spc::getOptLevelName(options.optimize.level) + (options.optAst ? " -opt-ast" : "");
+    flags += " -mcpu=" + options.targetConfig.cpu + " -mattr=" + options.targetConfig.features;
+    for (auto &feature : options.optimize.multiversion)
+        flags += " -fmultiversion=" + feature;
+    if (options.optimize.profileGenerate)
+        flags += " -fprofile-generate=" + options.optimize.profileGenerateFile;
+    if (!options.optimize.profileUse.empty())
+        flags += " -fprofile-use=" + options.optimize.profileUse;
+    if (options.target == Target::ASM || options.target == Target::OBJ)
+        flags += " " + llvm::sys::getDefaultTargetTriple();
+    return flags;
+}
+
+// The interface file of a unit is written next to its output
+static std::string get_interface_name(const std::string &output)
+{
+    llvm::SmallString<128> name(output);
+    llvm::sys::path::replace_extension(name, ".spi");
+    return name.str();
+}
 
-    spc::parser pars;
+// -I directories, then the directory of the source
+static std::vector<std::string> get_unit_path(const std::string &input, const Options &options)
+{
+    std::vector<std::string> unitPath = options.unitPath;
+    llvm::StringRef dir = llvm::sys::path::parent_path(input);
+    unitPath.push_back(dir.empty() ? "." : dir.str());
+    return unitPath;
+}
 
+// Looks the output of input up in the compile cache before it is scanned and parsed: the key covers
+// the source and the interface files its uses clauses lead to, which a pre-scan of the source finds.
+// On a hit a unit also gets its interface file back. The cache is looked up once more after parsing
+// when key is left empty: if the source does not pre-scan, a used unit cannot be found yet, or a used
+// unit is in batchUnits, the stems of the inputs of the batch that may be units, whose interface
+// files are only final once they are parsed.
+static bool fetch_cached(const std::string &input, const std::string &output, const Options &options,
+                         const llvm::StringSet<> &batchUnits, std::string &key, Clock::time_point start)
+{
+    key.clear();
+    // The symbol tables and IR can only be printed from a real compilation
+    if (options.cache == nullptr || options.target == Target::RUN || options.printTable || options.printLLVM)
+        return false;
+    bool isUnit;
+    std::vector<std::string> uses, deps;
+    std::string error;
+    if (!spc::Compilation::scanUses(input, isUnit, uses))
+        return false;
+    if (!options.optimize.profileUse.empty()) deps.push_back(options.optimize.profileUse);
+    if (!spc::UnitInterface::collect(uses, get_unit_path(input, options), deps, error))
+        return false;
+    for (auto &dep : deps)
+        if (llvm::sys::path::extension(dep) == ".spi" && batchUnits.count(llvm::sys::path::stem(dep)))
+            return false;
+    key = spc::CompileCache::key(input, cache_flags(options), deps);
+    if (key.empty() || !options.cache->fetch(key, output, isUnit ? get_interface_name(output) : ""))
+        return false;
+    if (options.verbose) std::cout << "Cache hit! Compile result output: " << output << std::endl;
+    if (options.time) std::cerr << "[time] " << input << ": " << std::fixed << std::setprecision(3) << elapsed_ms(start) << " ms (cached)" << std::endl;
+    return true;
+}
+
+// Parses the source of compilation. On failure returns false and sets error.
+// A unit also gets its interface file written, so that its users can be compiled right away.
+bool parse(spc::Compilation &compilation, const std::string &output, const Options &options, std::string &error)
+{
     try
     {
-        pars.parse();
+        compilation.parse();
+    }
+    catch(const std::runtime_error& e)
+    {
+        error = e.what();
+        return false;
     }
     catch(const std::invalid_argument& e)
     {
-        std::cerr << e.what() << std::endl;
-        std::cerr << "Terminated due to error during scanning" << std::endl;
-        exit(1);
+        error = std::string(e.what()) + "\nTerminated due to error during scanning";
+        return false;
     }
     catch(const std::logic_error& e)
     {
-        std::cerr << e.what() << std::endl;
-        std::cerr << "Terminated due to error during parsing" << std::endl;
-        exit(1);
+        error = std::string(e.what()) + "\nTerminated due to error during parsing";
+        return false;
     }
 
-    std::cout << "Scanning & Parsing completed!" << std::endl;
+    if (options.verbose) std::cout << "Scanning & Parsing completed!" << std::endl;
+
+    if (options.target == Target::RUN && compilation.isUnit())
+    {
+        error = "A unit has no main program to run";
+        return false;
+    }
+    if (options.target == Target::RUN && !compilation.getUses().empty())
+    {
+        error = "-run cannot load the units of a program, compile all of them with -emit-bc and run them with -lto -run";
+        return false;
+    }
+    if (compilation.isUnit())
+    {
+        std::string interfaceName = get_interface_name(output);
+        if (!compilation.writeInterface(interfaceName, error)) return false;
+        if (options.verbose) std::cout << "Unit interface output: " << interfaceName << std::endl;
+    }
+    return true;
+}
 
-    if (optAst)
+// Compiles a parsed source file, started at start. On failure returns false and sets error.
+// cacheKey is the key fetch_cached looked up and missed, the output is stored under it;
+// if it is empty the key is computed, and looked up, from the parsed uses clauses.
+// With Target::RUN the program is executed and its return value stored in exitCode.
+// Phase timings and memory usage are recorded into report when it is not null.
+bool compile(spc::Compilation &compilation, const std::string &output, const Options &options, std::string cacheKey, std::string &error, Clock::time_point start, int *exitCode = nullptr, spc::CompileReport *report = nullptr)
+{
+    const std::string &input = compilation.getInput();
+    auto unitPath = get_unit_path(input, options);
+    if (cacheKey.empty() && options.cache != nullptr && options.target != Target::RUN)
     {
-        spc::ASTopt astOpt;
-        astOpt(spc::cast_node<spc::BaseRoutineNode>(program));
+        std::vector<std::string> deps;
+        if (!options.optimize.profileUse.empty()) deps.push_back(options.optimize.profileUse);
+        // A changed interface recompiles the users of a unit, a changed implementation does not
+        if (!spc::UnitInterface::collect(compilation.getUses(), unitPath, deps, error)) return false;
+        cacheKey = spc::CompileCache::key(input, cache_flags(options), deps);
+        // The symbol tables and IR can only be printed from a real compilation
+        if (!cacheKey.empty() && !options.printTable && !options.printLLVM && options.cache->fetch(cacheKey, output))
+        {
+            if (options.verbose) std::cout << "Cache hit! Compile result output: " << output << std::endl;
+            if (options.time) std::cerr << "[time] " << input << ": " << std::fixed << std::setprecision(3) << elapsed_ms(start) << " ms (cached)" << std::endl;
+            return true;
+        }
     }
-    
+
+    if (options.optAst)
+        compilation.optimizeAST();
 
     std::string astVisName = input;
     astVisName.erase(astVisName.rfind('.'));
     astVisName.append(".output.tex");
-    spc::ASTvis astVis(astVisName);
-    astVis.travAST(program);
+    compilation.visualizeAST(astVisName);
 
-    std::cout << "AST verification completed! Output AST structure to " << astVisName << std::endl;
+    if (options.verbose) std::cout << "AST verification completed! Output AST structure to " << astVisName << std::endl;
 
-    spc::CodegenContext genContext("main", opt);
     try 
     {
-        program->codegen(genContext);
+        compilation.codegen(options.logFile, unitPath);
     } 
     catch (spc::CodegenException &e) 
     {
-        std::cerr << "[CODEGEN ERROR] ";
-        std::cerr << e.what() << std::endl;
-        std::cerr << "Terminated due to error during code generation" << std::endl;
-        if (genContext.log().is_open()) genContext.log().close();
-        abort();
+        error = std::string("[CODEGEN ERROR] ") + e.what() + "\nTerminated due to error during code generation";
+        return false;
     }
+    spc::CodegenContext &genContext = compilation.getCodegenContext();
 
-    if (printTable)
+    auto targetMachine = spc::createTargetMachine(options.optimize.level, options.targetConfig, error);
+    if (targetMachine == nullptr) return false;
+    try
+    {
+        std::unique_lock<std::mutex> lock(outputMutex, std::defer_lock);
+        if (options.optimize.printPipeline) lock.lock();
+        spc::OptimizeOptions optimize = options.optimize;
+        // bitcode is meant for -lto, which does the inlining once all modules are known
+        if (options.target == Target::BC) optimize.lto = spc::LTOPhase::PreLink;
+        compilation.optimize(*targetMachine, optimize);
+    }
+    catch (const std::runtime_error &e)
     {
+        error = e.what();
+        return false;
+    }
+
+    if (options.printTable)
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
         genContext.printGlobals();
         std::cout << std::endl;
         genContext.printFuncs();
@@ -201,39 +390,502 @@ int main(int argc, char* argv[])
         genContext.printConstVals();
         std::cout << std::endl;
     }
-    if (printLLVM)
+    if (options.printLLVM)
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
         genContext.dump();
-    std::cout << "Code generation completed!" << std::endl;
+    }
+    if (options.verbose) std::cout << "Code generation completed!" << std::endl;
 
-    std::string output;
-    if (outputP == nullptr)
-        output = input;
-    else
-        output = outputP;
-    output.erase(output.rfind('.'));
-    switch (target)
+    if (options.target == Target::RUN)
     {
-        case Target::LLVM: output.append(".ll"); break;
-        case Target::ASM:  output.append(".s");  break;
-        case Target::OBJ:  output.append(".o");  break;
-        default: break;
+        int ret = 0;
+        if (!run_jit(compilation.takeModule(), options, start, ret, error, report)) return false;
+        if (exitCode != nullptr) *exitCode = ret;
+        return true;
     }
+
     std::error_code ec;
     llvm::raw_fd_ostream fd(output, ec, llvm::sys::fs::F_None);
     if (ec)
     { 
-        llvm::errs() << "Could not open file: " << ec.message(); 
-        exit(1); 
+        error = "Could not open file: " + ec.message();
+        return false;
     }
+    spc::CompileReport::Scope emitScope(report, spc::CompileReport::Phase, "Code emission");
 
-    switch (target)
+    if (!emit_module(fd, options.target, *(genContext.getModule()), *targetMachine, error)) return false;
+    if (!cacheKey.empty())
     {
-        case Target::LLVM: genContext.getModule()->print(fd, nullptr); break;
-        case Target::ASM: emit_target(fd, llvm::TargetMachine::CGFT_AssemblyFile, *(genContext.getModule())); break;
-        case Target::OBJ: emit_target(fd, llvm::TargetMachine::CGFT_ObjectFile, *(genContext.getModule())); break;
-        default: break;
+        fd.close();
+        options.cache->store(cacheKey, output, compilation.isUnit() ? get_interface_name(output) : "");
     }
-    std::cout << "Compile result output: " << output << std::endl;
+    if (options.verbose) std::cout << "Compile result output: " << output << std::endl;
+    if (options.time) std::cerr << "[time] " << input << ": " << std::fixed << std::setprecision(3) << elapsed_ms(start) << " ms" << std::endl;
+    return true;
+}
 
-    return 0;
+// -lto: links the modules in inputs into one, internalizes everything but main and
+// optimizes the result as a whole program, which is then emitted like a compilation.
+bool link(const std::vector<std::string> &inputs, const std::string &output, const Options &options, std::string &error, int *exitCode = nullptr, spc::CompileReport *report = nullptr)
+{
+    auto start = Clock::now();
+    auto context = std::make_unique<llvm::LLVMContext>();
+    std::unique_ptr<llvm::Module> merged;
+    {
+        spc::CompileReport::Scope linkScope(report, spc::CompileReport::Phase, "Linking");
+        merged = std::make_unique<llvm::Module>(output, *context);
+        llvm::Linker linker(*merged);
+        for (auto &input : inputs)
+        {
+            llvm::SMDiagnostic diagnostic;
+            auto module = llvm::parseIRFile(input, diagnostic, *context);
+            if (module == nullptr)
+            {
+                llvm::raw_string_ostream os(error);
+                diagnostic.print("spc", os);
+                os.flush();
+                return false;
+            }
+            // Reports its diagnostics (e.g. conflicting definitions) through the context
+            if (linker.linkInModule(std::move(module)))
+            {
+                error = "Failed to link " + input;
+                return false;
+            }
+        }
+    }
+    auto *mainFunc = merged->getFunction("main");
+    if (mainFunc == nullptr || mainFunc->isDeclaration())
+    {
+        error = "No input defines main";
+        return false;
+    }
+    if (options.verbose) std::cout << "Linking completed!" << std::endl;
+
+    // Nothing outside the program can call into it, which frees the optimizer
+    // to inline, specialize and drop whatever main does not reach
+    llvm::internalizeModule(*merged, [](const llvm::GlobalValue &gv) { return gv.getName() == "main"; });
+
+    auto targetMachine = spc::createTargetMachine(options.optimize.level, options.targetConfig, error);
+    if (targetMachine == nullptr) return false;
+    try
+    {
+        spc::CompileReport::Scope optScope(report, spc::CompileReport::Phase, "LLVM optimization");
+        spc::OptimizeOptions optimize = options.optimize;
+        optimize.lto = spc::LTOPhase::Link;
+        spc::optimizeModule(*merged, *targetMachine, optimize);
+    }
+    catch (const std::runtime_error &e)
+    {
+        error = e.what();
+        return false;
+    }
+    if (llvm::verifyModule(*merged, &llvm::errs()))
+    {
+        error = "The linked module is broken";
+        return false;
+    }
+    if (options.printLLVM)
+        merged->print(llvm::outs(), nullptr);
+
+    if (options.target == Target::RUN)
+    {
+        int ret = 0;
+        if (!run_jit(llvm::orc::ThreadSafeModule(std::move(merged), std::move(context)), options, start, ret, error, report)) return false;
+        if (exitCode != nullptr) *exitCode = ret;
+        return true;
+    }
+
+    std::error_code ec;
+    llvm::raw_fd_ostream fd(output, ec, llvm::sys::fs::F_None);
+    if (ec)
+    {
+        error = "Could not open file: " + ec.message();
+        return false;
+    }
+    spc::CompileReport::Scope emitScope(report, spc::CompileReport::Phase, "Code emission");
+    if (!emit_module(fd, options.target, *merged, *targetMachine, error)) return false;
+    if (options.verbose) std::cout << "Link result output: " << output << std::endl;
+    if (options.time) std::cerr << "[time] link: " << std::fixed << std::setprecision(3) << elapsed_ms(start) << " ms" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    std::vector<std::string> inputs;
+    char *outputP = nullptr;
+    unsigned jobs = 1;
+    std::string cacheDir;
+    uint64_t cacheSizeMB = 512;
+    bool cacheStats = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-ir") == 0) options.target = Target::LLVM;
+        else if (strcmp(argv[i], "-S") == 0) options.target = Target::ASM;
+        else if (strcmp(argv[i], "-c") == 0) options.target = Target::OBJ;
+        else if (strcmp(argv[i], "-emit-bc") == 0) options.target = Target::BC;
+        else if (strcmp(argv[i], "-lto") == 0) options.lto = true;
+        else if (strcmp(argv[i], "-run") == 0) options.target = Target::RUN;
+        else if (strcmp(argv[i], "-time") == 0) options.time = true;
+        else if (strcmp(argv[i], "-ftime-report") == 0) options.timeReport = true;
+        else if (strcmp(argv[i], "-fmem-report") == 0) options.memReport = true;
+        else if (strncmp(argv[i], "-freport-json=", 14) == 0) options.reportJSON = argv[i] + 14;
+        else if (strncmp(argv[i], "-O", 2) == 0)
+        {
+            if (!spc::parseOptLevel(argv[i] + 2, options.optimize.level))
+            {
+                std::cerr << "Error: unknown optimization level: " << argv[i] << std::endl;
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-print-pipeline") == 0) options.optimize.printPipeline = true;
+        else if (strcmp(argv[i], "-march=native") == 0) options.targetConfig = spc::getHostTargetConfig();
+        else if (strncmp(argv[i], "-march=", 7) == 0) options.targetConfig.cpu = argv[i] + 7;
+        else if (strncmp(argv[i], "-mcpu=", 6) == 0) options.targetConfig.cpu = argv[i] + 6;
+        else if (strncmp(argv[i], "-mattr=", 7) == 0)
+        {
+            if (!options.targetConfig.features.empty()) options.targetConfig.features += ",";
+            options.targetConfig.features += argv[i] + 7;
+        }
+        else if (strncmp(argv[i], "-fmultiversion=", 15) == 0)
+        {
+            std::stringstream list(argv[i] + 15);
+            std::string feature;
+            while (std::getline(list, feature, ','))
+                if (!feature.empty()) options.optimize.multiversion.push_back(feature);
+        }
+        else if (strcmp(argv[i], "-fprofile-generate") == 0) options.optimize.profileGenerate = true;
+        else if (strncmp(argv[i], "-fprofile-generate=", 19) == 0)
+        {
+            options.optimize.profileGenerate = true;
+            options.optimize.profileGenerateFile = argv[i] + 19;
+        }
+        else if (strncmp(argv[i], "-fprofile-use=", 14) == 0) options.optimize.profileUse = argv[i] + 14;
+        else if (strcmp(argv[i], "-opt-ast") == 0) options.optAst = true;
+        else if (strcmp(argv[i], "-print-table") == 0) options.printTable = true;
+        else if (strcmp(argv[i], "-print-llvm") == 0) options.printLLVM = true;
+        else if (strncmp(argv[i], "-I", 2) == 0)
+        {
+            const char *dir = argv[i][2] != '\0' ? argv[i] + 2 : (i < argc - 1 ? argv[++i] : nullptr);
+            if (dir == nullptr)
+            {
+                std::cerr << "Error: -I expects a directory" << std::endl;
+                exit(1);
+            }
+            options.unitPath.push_back(dir);
+        }
+        else if (strcmp(argv[i], "-o") == 0)
+        {
+            if (i == argc - 1) 
+            {
+                std::cerr << "Error: unspecified output file" << std::endl;
+                exit(1);
+            }
+            outputP = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache-dir") == 0 || strcmp(argv[i], "--cache-size") == 0)
+        {
+            if (i == argc - 1)
+            {
+                std::cerr << "Error: " << argv[i] << " expects an argument" << std::endl;
+                exit(1);
+            }
+            if (strcmp(argv[i], "--cache-dir") == 0)
+                cacheDir = argv[++i];
+            else if ((cacheSizeMB = strtoull(argv[++i], nullptr, 10)) == 0)
+            {
+                std::cerr << "Error: --cache-size expects a positive number of megabytes" << std::endl;
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--cache-stats") == 0) cacheStats = true;
+        else if (strncmp(argv[i], "-j", 2) == 0)
+        {
+            const char *n = argv[i][2] != '\0' ? argv[i] + 2 : (i < argc - 1 ? argv[++i] : nullptr);
+            if (n == nullptr || atoi(n) <= 0)
+            {
+                std::cerr << "Error: -j expects a positive number of jobs" << std::endl;
+                exit(1);
+            }
+            jobs = atoi(n);
+        }
+        else if (argv[i][0] == '-')
+        { 
+            fprintf(stderr, "Error: unknown argument: %s", argv[i]); 
+            exit(1); 
+        }
+        else inputs.push_back(argv[i]);
+    }
+    // linking produces an object file unless told otherwise
+    if (options.lto && options.target == Target::UNDEFINED) options.target = Target::OBJ;
+    if (options.target == Target::UNDEFINED || inputs.empty())
+    {
+        puts("USAGE: spc <option> <input file>...");
+        puts("OPTION:");
+        puts("  -ir                  Emit LLVM assembly code (.ll)");
+        puts("  -S                   Emit assembly code (.s)");
+        puts("  -c                   Emit object code (.o)");
+        puts("  -emit-bc             Emit LLVM bitcode (.bc) for a later -lto link");
+        puts("  -run                 Compile in memory and run the program (JIT)");
+        puts("  -lto <.bc/.ll>...    Link the modules into one program and optimize it as a whole (default -c)");
+        puts(" [-o <output file>]    Specify output file (single input or -lto only)");
+        puts(" [-j <jobs>]           Compile several input files in parallel");
+        puts(" [-I <dir>]            Search <dir> for the interface files (.spi) of used units, before the source's directory");
+        puts(" [-O0|-O1|-O2|-O3|-Os|-Oz]  LLVM optimization level (-O is -O2, default -O0)");
+        puts(" [-print-pipeline]     Print the LLVM pass pipeline and each pass as it runs");
+        puts(" [-march=native|<cpu>] Generate code for the host CPU and its features, or for <cpu>");
+        puts(" [-mcpu=<cpu>]         Generate code for <cpu> (default generic)");
+        puts(" [-mattr=<+f,-g,...>]  Enable or disable target features");
+        puts(" [-fmultiversion=<f,...>]  Clone routines with loops for each x86 feature <f> and pick one at load time (-S/-c)");
+        puts(" [-fprofile-generate[=<f>]]  Instrument the program to write a profile to <f> (default.profraw) at exit");
+        puts(" [-fprofile-use=<f>]   Optimize with the profile <f> merged by llvm-profdata");
+        puts(" [-opt-ast]            Enable AST optimizations");
+        puts(" [-print-table]        Print the symbol table");
+        puts(" [-print-llvm]         Print the LLVM IR");
+        puts(" [-time]               Report compile time (and latency until the program starts with -run)");
+        puts(" [-ftime-report]       Print the time spent in each phase, routine and LLVM pass");
+        puts(" [-fmem-report]        Print the memory usage after each phase");
+        puts(" [-freport-json=<f>]   Write the time and memory report as JSON to <f>");
+        puts(" [--cache-dir <dir>]   Reuse outputs of identical compilations cached in <dir>");
+        puts(" [--cache-size <MB>]   Size limit of the cache, least recently used outputs are evicted (default 512)");
+        puts(" [--cache-stats]       Print the cache hits and misses");
+        exit(1);
+    }
+    if (outputP != nullptr && inputs.size() > 1 && !options.lto)
+    {
+        std::cerr << "Error: -o cannot be used with multiple input files" << std::endl;
+        exit(1);
+    }
+    if (options.target == Target::RUN && !options.optimize.multiversion.empty())
+    {
+        std::cerr << "Error: -fmultiversion needs -S or -c, the JIT cannot resolve ifuncs" << std::endl;
+        exit(1);
+    }
+    if (options.optimize.profileGenerate && !options.optimize.profileUse.empty())
+    {
+        std::cerr << "Error: -fprofile-generate and -fprofile-use cannot be combined" << std::endl;
+        exit(1);
+    }
+    if ((options.optimize.profileGenerate || !options.optimize.profileUse.empty()) && options.optimize.level == spc::OptLevel::O0)
+    {
+        std::cerr << "Error: -fprofile-generate and -fprofile-use need -O1 or higher" << std::endl;
+        exit(1);
+    }
+    if (options.optimize.profileGenerate && options.target == Target::RUN)
+    {
+        std::cerr << "Error: -fprofile-generate needs -S or -c, the JIT has no profile runtime" << std::endl;
+        exit(1);
+    }
+    if (!options.optimize.profileUse.empty() && !llvm::sys::fs::exists(options.optimize.profileUse))
+    {
+        std::cerr << "Error: profile not found: " << options.optimize.profileUse << std::endl;
+        exit(1);
+    }
+    if (options.target == Target::RUN && inputs.size() > 1 && !options.lto)
+    {
+        std::cerr << "Error: -run accepts exactly one input file" << std::endl;
+        exit(1);
+    }
+
+    // Target registries are process-wide, initialize them once for all compilations
+    init_targets();
+
+    std::unique_ptr<spc::CompileCache> cache;
+    if (!cacheDir.empty())
+    {
+        std::string error;
+        cache.reset(new spc::CompileCache(cacheDir, cacheSizeMB << 20));
+        if (!cache->init(error))
+        {
+            std::cerr << error << std::endl;
+            exit(1);
+        }
+        options.cache = cache.get();
+    }
+
+    bool reporting = options.timeReport || options.memReport || !options.reportJSON.empty();
+    std::vector<std::unique_ptr<spc::CompileReport>> reports;
+    if (reporting && options.lto)
+        reports.emplace_back(new spc::CompileReport(get_output_name(inputs[0], outputP, options.target)));
+    else if (reporting)
+        for (auto &input : inputs)
+            reports.emplace_back(new spc::CompileReport(input));
+    // LLVM's pass timers are process-wide and not thread-safe, only collect them when compiling serially
+    jobs = options.lto ? 1 : std::min<unsigned>(jobs, inputs.size());
+    // The pass timers of the optimizer live in the handler, the report reads them after the last module
+    std::unique_ptr<llvm::TimePassesHandler> timePasses;
+    if (reporting && jobs == 1)
+    {
+        llvm::TimePassesIsEnabled = true;
+        timePasses.reset(new llvm::TimePassesHandler(true));
+        options.optimize.timePasses = timePasses.get();
+    }
+
+    auto printReports = [&]()
+    {
+        if (!reporting) return true;
+        for (auto &report : reports)
+        {
+            if (options.timeReport) report->printTimeTable(std::cerr);
+            if (options.memReport) report->printMemTable(std::cerr);
+        }
+        if (!options.reportJSON.empty())
+        {
+            std::error_code ec;
+            llvm::raw_fd_ostream json(options.reportJSON, ec, llvm::sys::fs::F_None);
+            if (ec)
+            {
+                std::cerr << "Could not open file: " << ec.message() << std::endl;
+                return false;
+            }
+            std::ostringstream files;
+            for (size_t i = 0; i < reports.size(); ++i)
+            {
+                files << (i == 0 ? "\n    " : ",\n    ");
+                reports[i]->printJSON(files);
+            }
+            json << "{\n  \"files\": [" << files.str() << "\n  ],\n  \"llvm\": {\n";
+            if (llvm::TimePassesIsEnabled)
+                llvm::TimerGroup::printAllJSONValues(json, "");
+            json << "\n  }\n}\n";
+        }
+        // Prints and clears the per-pass tables of the code generator (legacy pass manager) and the optimizer
+        if (llvm::TimePassesIsEnabled && options.timeReport)
+        {
+            llvm::reportAndResetTimings(&llvm::errs());
+            timePasses->print();
+        }
+        // Timers still holding data would print themselves when destroyed at exit
+        if (llvm::TimePassesIsEnabled)
+            llvm::TimerGroup::clearAll();
+        return true;
+    };
+
+    if (options.lto)
+    {
+        std::string error;
+        int exitCode = 0;
+        if (options.target == Target::RUN) options.verbose = false;
+        bool success = link(inputs, get_output_name(inputs[0], outputP, options.target), options, error, &exitCode, reporting ? reports[0].get() : nullptr);
+        if (!success)
+            std::cerr << error << std::endl;
+        if (!printReports() || !success)
+            return 1;
+        return exitCode;
+    }
+
+    if (inputs.size() == 1)
+    {
+        std::string error;
+        int exitCode = 0;
+        // keep stdout for the program's own output
+        if (options.target == Target::RUN) options.verbose = false;
+        auto start = Clock::now();
+        auto *report = reporting ? reports[0].get() : nullptr;
+        spc::Compilation compilation(inputs[0], report);
+        std::string output = get_output_name(inputs[0], outputP, options.target);
+        std::string cacheKey;
+        bool success = fetch_cached(inputs[0], output, options, {}, cacheKey, start)
+            || (parse(compilation, output, options, error) && compile(compilation, output, options, cacheKey, error, start, &exitCode, report));
+        if (!success)
+            std::cerr << error << std::endl;
+        if (cache && cacheStats)
+            cache->printStats(std::cerr);
+        if (!printReports() || !success)
+            return 1;
+        return exitCode;
+    }
+
+    // Batch mode: every file gets its own Compilation (and LLVMContext) on a worker thread.
+    // All files are parsed before any is compiled: parsing writes the interface files of the
+    // units among them, so the users of a unit compile in parallel with the unit itself.
+    struct Result
+    {
+        bool success = false, cached = false;
+        double ms = 0;
+        std::string output, error, cacheKey;
+    };
+    std::vector<Result> results(inputs.size());
+    std::vector<std::unique_ptr<spc::Compilation>> compilations(inputs.size());
+    options.verbose = false;
+
+    auto parallel = [&](const std::function<void(size_t)> &work)
+    {
+        std::atomic<size_t> next(0);
+        auto worker = [&]()
+        {
+            for (size_t i = next++; i < inputs.size(); i = next++)
+                work(i);
+        };
+        std::vector<std::thread> threads;
+        for (unsigned j = 1; j < jobs; ++j)
+            threads.emplace_back(worker);
+        worker();
+        for (auto &t : threads)
+            t.join();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    // Files that may be units of the batch: their users are looked up in the cache only after parsing
+    llvm::StringSet<> batchUnits;
+    if (cache)
+        for (auto &input : inputs)
+        {
+            bool isUnit = true;
+            std::vector<std::string> uses;
+            spc::Compilation::scanUses(input, isUnit, uses);
+            if (isUnit)
+                batchUnits.insert(llvm::sys::path::stem(input));
+        }
+    parallel([&](size_t i)
+    {
+        results[i].output = get_output_name(inputs[i], nullptr, options.target);
+        auto fileStart = Clock::now();
+        results[i].cached = fetch_cached(inputs[i], results[i].output, options, batchUnits, results[i].cacheKey, fileStart);
+        if (results[i].cached)
+            results[i].success = true;
+        else
+        {
+            compilations[i].reset(new spc::Compilation(inputs[i], reporting ? reports[i].get() : nullptr));
+            results[i].success = parse(*compilations[i], results[i].output, options, results[i].error);
+        }
+        results[i].ms = elapsed_ms(fileStart);
+    });
+    parallel([&](size_t i)
+    {
+        if (results[i].success && !results[i].cached)
+        {
+            Options fileOptions = options;
+            fileOptions.logFile = results[i].output.substr(0, results[i].output.rfind('.')) + ".log";
+            auto fileStart = Clock::now();
+            results[i].success = compile(*compilations[i], results[i].output, fileOptions, results[i].cacheKey, results[i].error, fileStart, nullptr, reporting ? reports[i].get() : nullptr);
+            results[i].ms += elapsed_ms(fileStart);
+        }
+        // the AST and module are not needed anymore
+        compilations[i].reset();
+    });
+    double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    std::cout << "Batch compilation summary:" << std::endl;
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        std::cout << (results[i].success ? "  [ OK ] " : "  [FAIL] ") << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << results[i].ms << " ms  " << inputs[i];
+        if (results[i].success)
+            std::cout << " -> " << results[i].output << std::endl;
+        else
+        {
+            ++failed;
+            std::cout << std::endl << results[i].error << std::endl;
+        }
+    }
+    std::cout << inputs.size() << " files, " << failed << " failed, " << total << " ms wall time with " << jobs << " jobs" << std::endl;
+    if (cache && cacheStats)
+        cache->printStats(std::cout);
+    if (!printReports()) return 1;
+    return failed == 0 ? 0 : 1;
 }
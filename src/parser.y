@@ -23,13 +23,16 @@
     using namespace std;
     namespace spc {}
     using namespace spc;
-    
-    extern std::shared_ptr<ProgramNode> program;
-    extern int line_no;
+
+    typedef void *yyscan_t;
 }
 
+// 可重入：扫描器句柄与语法树根节点都由调用者传入，不使用全局变量
+%parse-param {yyscan_t scanner} {spc::BaseRoutineNode *&root}
+%lex-param {yyscan_t scanner}
+
 %code {
-    int yylex(spc::parser::semantic_type* lval, spc::parser::location_type* loc);
+    int yylex(spc::parser::semantic_type* lval, spc::parser::location_type* loc, yyscan_t scanner);
 }
 
 %locations
@@ -37,7 +40,7 @@
 %define parse.error verbose
 
 // 定义terminal：token
-%token PROGRAM ID CONST ARRAY VAR FUNCTION PROCEDURE PBEGIN END TYPE RECORD
+%token PROGRAM UNIT USES INTERFACE IMPLEMENTATION ID CONST ARRAY VAR FUNCTION PROCEDURE PBEGIN END TYPE RECORD
 %token INTEGER REAL CHAR STRING
 %token SYS_CON SYS_FUNCT SYS_PROC SYS_TYPE STR_TYPE
 %token IF THEN ELSE REPEAT UNTIL WHILE DO FOR TO DOWNTO CASE OF GOTO
@@ -45,57 +48,88 @@
 %token PLUS MINUS MUL DIV MOD TRUEDIV AND OR XOR NOT
 %token DOT DOTDOT SEMI LP RP LB RB COMMA COLON
 
-%type <std::shared_ptr<IntegerNode>> INTEGER
-%type <std::shared_ptr<RealNode>> REAL
-%type <std::shared_ptr<CharNode>> CHAR
-%type <std::shared_ptr<StringNode>> STRING
-%type <std::shared_ptr<IdentifierNode>> ID
-%type <std::shared_ptr<SimpleTypeNode>> SYS_TYPE
+%type <IntegerNode *> INTEGER
+%type <RealNode *> REAL
+%type <CharNode *> CHAR
+%type <StringNode *> STRING
+%type <IdentifierNode *> ID
+%type <SimpleTypeNode *> SYS_TYPE
 %type <spc::SysFunc> SYS_PROC SYS_FUNCT
 %type <spc::ForDirection> TO DOWNTO
-%type <std::shared_ptr<ConstValueNode>> SYS_CON
-
-%type <std::shared_ptr<ProgramNode>> program
-%type <std::shared_ptr<RoutineHeadNode>> routine_head
-%type <std::shared_ptr<RoutineList>> routine_part 
-%type <std::shared_ptr<RoutineNode>> function_decl procedure_decl
-%type <std::shared_ptr<ConstDeclList>> const_part const_expr_list
-%type <std::shared_ptr<TypeDeclList>> type_part type_decl_list
-%type <std::shared_ptr<VarDeclList>> var_part var_decl_list var_decl
-%type <std::shared_ptr<ConstValueNode>> const_value
-%type <std::shared_ptr<TypeNode>> type_decl simple_type_decl
-%type <std::shared_ptr<StringTypeNode>> string_type_decl
-%type <std::shared_ptr<ArrayTypeNode>> array_type_decl
-%type <std::pair<std::shared_ptr<IdentifierList>, std::shared_ptr<TypeNode>>> field_decl
-%type <std::shared_ptr<RecordTypeNode>> record_type_decl field_decl_list 
-%type <std::pair<std::shared_ptr<ExprNode>, std::shared_ptr<ExprNode>>> array_range
-%type <std::shared_ptr<TypeDeclNode>> type_definition 
-%type <std::shared_ptr<IdentifierList>> name_list var_para_list
-%type <std::shared_ptr<ParamList>> parameters para_decl_list para_type_list
-%type <std::shared_ptr<AssignStmtNode>> assign_stmt
-%type <std::shared_ptr<ProcStmtNode>> proc_stmt
-%type <std::shared_ptr<CompoundStmtNode>> compound_stmt stmt_list stmt else_clause routine_body
-%type <std::shared_ptr<IfStmtNode>> if_stmt
-%type <std::shared_ptr<RepeatStmtNode>> repeat_stmt
-%type <std::shared_ptr<WhileStmtNode>> while_stmt
-%type <std::shared_ptr<ForStmtNode>> for_stmt
+%type <ConstValueNode *> SYS_CON
+
+%type <ProgramNode *> program
+%type <UnitNode *> unit
+%type <IdentifierList *> uses_clause
+%type <RoutineHeadNode *> routine_head interface_part
+%type <RoutineList *> routine_part interface_routine_part
+%type <RoutineNode *> function_decl procedure_decl
+%type <ConstDeclList *> const_part const_expr_list
+%type <TypeDeclList *> type_part type_decl_list
+%type <VarDeclList *> var_part var_decl_list var_decl
+%type <ConstValueNode *> const_value
+%type <TypeNode *> type_decl simple_type_decl
+%type <StringTypeNode *> string_type_decl
+%type <ArrayTypeNode *> array_type_decl
+%type <std::pair<IdentifierList *, TypeNode *>> field_decl
+%type <RecordTypeNode *> record_type_decl field_decl_list 
+%type <std::pair<ExprNode *, ExprNode *>> array_range
+%type <TypeDeclNode *> type_definition 
+%type <IdentifierList *> name_list
+%type <std::pair<spc::ParamMode, IdentifierList *>> var_para_list
+%type <ParamList *> parameters para_decl_list para_type_list
+%type <AssignStmtNode *> assign_stmt
+%type <ProcStmtNode *> proc_stmt
+%type <CompoundStmtNode *> compound_stmt stmt_list stmt else_clause routine_body
+%type <IfStmtNode *> if_stmt
+%type <RepeatStmtNode *> repeat_stmt
+%type <WhileStmtNode *> while_stmt
+%type <ForStmtNode *> for_stmt
 %type <spc::ForDirection> direction
-%type <std::shared_ptr<CaseStmtNode>> case_stmt
-%type <std::shared_ptr<CaseBranchList>> case_expr_list
-%type <std::shared_ptr<CaseBranchNode>> case_expr
-%type <std::shared_ptr<LeftExprNode>> left_expr
-%type <std::shared_ptr<ExprNode>> expression expr term factor
-%type <std::shared_ptr<ArgList>> args_list
+%type <CaseStmtNode *> case_stmt
+%type <CaseBranchList *> case_expr_list
+%type <CaseBranchNode *> case_expr
+%type <LeftExprNode *> left_expr
+%type <ExprNode *> expression expr term factor arg
+%type <ArgList *> args_list
 
-%start program
+%start compilation_unit
 
 %%
 
-program: PROGRAM ID SEMI routine_head routine_body DOT{
-        program = make_node<ProgramNode>($2, $4, $5);
+compilation_unit: program { root = $1; }
+    | unit { root = $1; }
+    ;
+
+program: PROGRAM ID SEMI uses_clause routine_head routine_body DOT{
+        $$ = make_node<ProgramNode>($2, $4, $5, $6);
+    }
+    ;
+
+unit: UNIT ID SEMI INTERFACE uses_clause interface_part IMPLEMENTATION uses_clause routine_head END DOT {
+        $$ = make_node<UnitNode>($2, $5, $6, $8, $9);
+    }
+    ;
+
+uses_clause: USES name_list SEMI { $$ = $2; }
+    | { $$ = make_node<IdentifierList>(); }
+    ;
+
+interface_part: const_part type_part var_part interface_routine_part {
+        $$ = make_node<RoutineHeadNode>($1, $3, $2, $4);
     }
     ;
 
+// headings only, the routines are defined in the implementation
+interface_routine_part: interface_routine_part FUNCTION ID parameters COLON simple_type_decl SEMI {
+        $$ = $1; $$->append(make_node<RoutineNode>($3, nullptr, nullptr, $4, $6));
+    }
+    | interface_routine_part PROCEDURE ID parameters SEMI {
+        $$ = $1; $$->append(make_node<RoutineNode>($3, nullptr, nullptr, $4, make_node<VoidTypeNode>()));
+    }
+    | { $$ = make_node<RoutineList>(); }
+    ;
+
 routine_head: const_part type_part var_part routine_part {
         $$ = make_node<RoutineHeadNode>($1, $3, $2, $4);
     }
@@ -236,14 +270,17 @@ para_decl_list: para_decl_list SEMI para_type_list {
 
 para_type_list: var_para_list COLON type_decl /*simple_type_decl*/ {
         $$ = make_node<ParamList>();
-        for (auto &name : $1->getChildren()) $$->append(make_node<ParamNode>(name, $3));
+        for (auto &name : $1.second->getChildren()) $$->append(make_node<ParamNode>(name, $3, $1.first));
     }
     ;
 
 var_para_list: VAR name_list {
-        $$ = $2;
+        $$ = std::make_pair(ParamMode::ByVar, $2);
+    }
+    | CONST name_list {
+        $$ = std::make_pair(ParamMode::ByConst, $2);
     }
-    | name_list {$$ = $1;}
+    | name_list {$$ = std::make_pair(ParamMode::ByValue, $1);}
     ;
 
 routine_body: compound_stmt {
@@ -382,14 +419,20 @@ left_expr: ID { $$ = $1; }
     | left_expr DOT ID { $$ = make_node<RecordRefNode>($1, $3); }
     ;
 
-args_list: args_list COMMA expression {
+args_list: args_list COMMA arg {
         $$ = $1; $$->append($3);
     }
-    | expression {
+    | arg {
         $$ = make_node<ArgList>($1);// $$->add_child($1);
     }
     ;
 
+// width and precision of write/writeln
+arg: expression
+    | expression COLON expression { $$ = make_node<FormatExprNode>($1, $3); }
+    | expression COLON expression COLON expression { $$ = make_node<FormatExprNode>($1, $3, $5); }
+    ;
+
 %%
 
 void spc::parser::error(const spc::parser::location_type &loc, const std::string& msg) {
@@ -0,0 +1,133 @@
+#include "format.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Two chars per value, "00" to "99": the digits are produced a pair per division
+static const char digit_pairs[200] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+static const uint64_t powers_of_10[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+    1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+};
+
+// Write the decimal digits of value backwards, ending just before end, and return the first one
+static char *put_digits(char *end, uint64_t value)
+{
+    char *p = end;
+    while (value >= 100)
+    {
+        p -= 2;
+        memcpy(p, digit_pairs + value % 100 * 2, 2);
+        value /= 100;
+    }
+    if (value >= 10)
+    {
+        p -= 2;
+        memcpy(p, digit_pairs + value * 2, 2);
+    }
+    else
+        *--p = (char)('0' + value);
+    return p;
+}
+
+// As put_digits, with exactly count digits, leading zeros included
+static char *put_fixed_digits(char *end, uint64_t value, int32_t count)
+{
+    char *p = end;
+    for (; count >= 2; count -= 2)
+    {
+        p -= 2;
+        memcpy(p, digit_pairs + value % 100 * 2, 2);
+        value /= 100;
+    }
+    if (count == 1)
+        *--p = (char)('0' + value % 10);
+    return p;
+}
+
+int32_t spc_fmt_int(char *buf, int32_t value)
+{
+    char digits[10];
+    char *end = digits + sizeof(digits);
+    // negated as unsigned, INT32_MIN included
+    char *p = put_digits(end, value < 0 ? 0u - (uint32_t)value : (uint32_t)value);
+    int32_t n = 0;
+    if (value < 0)
+        buf[n++] = '-';
+    memcpy(buf + n, p, (size_t)(end - p));
+    return n + (int32_t)(end - p);
+}
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128_t;
+
+// Precisions printed without printf
+#define FAST_PRECISION 17
+
+static const uint64_t powers_of_5[] = {
+    1ull, 5ull, 25ull, 125ull, 625ull, 3125ull, 15625ull, 78125ull, 390625ull, 1953125ull,
+    9765625ull, 48828125ull, 244140625ull, 1220703125ull, 6103515625ull, 30517578125ull,
+    152587890625ull, 762939453125ull,
+};
+#endif
+
+int32_t spc_fmt_real(char *buf, double value, int32_t precision)
+{
+    if (precision < 0)
+        precision = 0;
+    else if (precision > SPC_FMT_MAX_PRECISION)
+        precision = SPC_FMT_MAX_PRECISION;
+#ifdef __SIZEOF_INT128__
+    // When value * 10^precision is below 10^18 it is rounded to an integer exactly, in 128 bit
+    // integer arithmetic: value is m * 2^e, so value * 10^p is m * 5^p * 2^(e + p), and the
+    // bits shifted out decide the rounding, to nearest with ties to even like printf.
+    // NaN fails the comparison and goes to printf with infinities and the large values.
+    if (precision <= FAST_PRECISION && (value < 0 ? -value : value) < 1e18 / (double)powers_of_10[precision])
+    {
+        uint64_t bits, m, n;
+        int32_t e, shift, len = 0;
+        uint128_t scaled;
+        char digits[40];
+        char *end = digits + sizeof(digits), *p;
+        memcpy(&bits, &value, sizeof(bits));
+        m = bits & ((1ull << 52) - 1);
+        e = (int32_t)(bits >> 52 & 0x7ff);
+        if (e == 0)
+            e = -1074;
+        else
+        {
+            m |= 1ull << 52;
+            e -= 1075;
+        }
+        scaled = (uint128_t)m * powers_of_5[precision];
+        shift = -(e + precision);
+        if (shift <= 0)
+            n = (uint64_t)(scaled << -shift);
+        else if (shift >= 127)
+            n = 0; // scaled < 2^93, so this is below one half
+        else
+        {
+            uint128_t rest = scaled & (((uint128_t)1 << shift) - 1), half = (uint128_t)1 << (shift - 1);
+            n = (uint64_t)(scaled >> shift);
+            if (rest > half || (rest == half && (n & 1)))
+                n++;
+        }
+        p = put_fixed_digits(end, n % powers_of_10[precision], precision);
+        if (precision > 0)
+            *--p = '.';
+        p = put_digits(p, n / powers_of_10[precision]);
+        // printf keeps the sign of a negative value rounded to zero, and of -0.0
+        if (bits >> 63)
+            buf[len++] = '-';
+        memcpy(buf + len, p, (size_t)(end - p));
+        return len + (int32_t)(end - p);
+    }
+#endif
+    return snprintf(buf, SPC_FMT_REAL_SIZE + 1, "%.*f", precision, value);
+}
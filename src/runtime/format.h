@@ -0,0 +1,25 @@
+#ifndef SPCRT_FORMAT_H
+#define SPCRT_FORMAT_H
+
+/*
+ * Number formatting shared by write, str() and concat(). Not part of the ABI: the
+ * generated code never calls these.
+ */
+
+#include <stdint.h>
+
+/* Longest output of spc_fmt_int, "-2147483648" */
+#define SPC_FMT_INT_SIZE 11
+/* Precisions beyond this print as this many digits */
+#define SPC_FMT_MAX_PRECISION 255
+/* Longest output of spc_fmt_real: sign, the 309 integer digits of DBL_MAX, point and fraction */
+#define SPC_FMT_REAL_SIZE (1 + 309 + 1 + SPC_FMT_MAX_PRECISION)
+
+/* Writes value in decimal to buf and returns the number of chars, no NUL is added */
+int32_t spc_fmt_int(char *buf, int32_t value);
+/* Writes value with precision digits after the point, exactly as printf("%.*f") does, to buf
+ * and returns the number of chars, no NUL is added. precision is clamped to
+ * [0, SPC_FMT_MAX_PRECISION]; buf has to hold SPC_FMT_REAL_SIZE + 1 chars. */
+int32_t spc_fmt_real(char *buf, double value, int32_t precision);
+
+#endif
@@ -0,0 +1,372 @@
+// mmap, fstat and read
+#define _POSIX_C_SOURCE 200809L
+
+#include "str.h"
+#include "format.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Output of write/writeln. Each thread fills its own buffer, so writing takes no lock and
+// parses no format; the buffer goes to stdout when it is full and on spc_flush.
+#define OUT_SIZE 65536
+
+static _Thread_local struct
+{
+    int32_t len;
+    char data[OUT_SIZE];
+} out;
+
+void spc_flush(void)
+{
+    if (out.len > 0)
+        fwrite(out.data, 1, (size_t)out.len, stdout);
+    out.len = 0;
+    fflush(stdout);
+}
+
+static char *out_reserve(int32_t len)
+{
+    if (out.len + len > OUT_SIZE)
+        spc_flush();
+    return out.data + out.len;
+}
+
+// Right-aligns the len chars about to be written in a field of width chars
+static void out_pad(int32_t len, int32_t width)
+{
+    while (width > len)
+    {
+        int32_t count = width - len < OUT_SIZE ? width - len : OUT_SIZE;
+        memset(out_reserve(count), ' ', (size_t)count);
+        out.len += count;
+        width -= count;
+    }
+}
+
+void spc_write_int(int32_t value, int32_t width)
+{
+    char buf[SPC_FMT_INT_SIZE];
+    int32_t len = spc_fmt_int(buf, value);
+    out_pad(len, width);
+    memcpy(out_reserve(len), buf, (size_t)len);
+    out.len += len;
+}
+
+void spc_write_real(double value, int32_t width, int32_t precision)
+{
+    char buf[SPC_FMT_REAL_SIZE + 1];
+    int32_t len = spc_fmt_real(buf, value, precision);
+    out_pad(len, width);
+    memcpy(out_reserve(len), buf, (size_t)len);
+    out.len += len;
+}
+
+void spc_write_char(char value, int32_t width)
+{
+    out_pad(1, width);
+    *out_reserve(1) = value;
+    out.len++;
+}
+
+void spc_write_str(const spc_str *s, int32_t width)
+{
+    int32_t len = s == NULL ? 0 : s->len;
+    out_pad(len, width);
+    if (len > OUT_SIZE)
+    {
+        spc_flush();
+        fwrite(s->data, 1, (size_t)len, stdout);
+        return;
+    }
+    if (len > 0)
+        memcpy(out_reserve(len), s->data, (size_t)len);
+    out.len += len;
+}
+
+// Input of read/readln. stdin is mapped whole when it is a regular file and read in chunks
+// otherwise, and the values are parsed straight from the bytes. Unlike the output, the reader
+// state below is shared by all threads and takes no lock: input is not thread-safe, only one
+// thread may read.
+#define IN_SIZE 65536
+
+static struct
+{
+    const char *pos, *end;
+    int opened, done;
+    char chunk[IN_SIZE];
+} in;
+
+// Makes more input available at in.pos, returns 0 at the end of the input
+static int in_fill(void)
+{
+    ssize_t n;
+    if (!in.opened)
+    {
+        struct stat st;
+        off_t offset;
+        in.opened = 1;
+        if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode)
+            && (offset = lseek(STDIN_FILENO, 0, SEEK_CUR)) >= 0 && st.st_size > offset)
+        {
+            void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+            if (map != MAP_FAILED)
+            {
+                in.pos = (const char *)map + offset;
+                in.end = (const char *)map + st.st_size;
+                in.done = 1;
+                return 1;
+            }
+        }
+    }
+    if (in.done)
+        return 0;
+    do
+        n = read(STDIN_FILENO, in.chunk, IN_SIZE);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+    {
+        in.done = 1;
+        return 0;
+    }
+    in.pos = in.chunk;
+    in.end = in.chunk + n;
+    return 1;
+}
+
+static int in_peek(void)
+{
+    if (in.pos == in.end && !in_fill())
+        return EOF;
+    return (unsigned char)*in.pos;
+}
+
+static int in_skip_space(void)
+{
+    int c;
+    while ((c = in_peek()) != EOF && isspace(c))
+        in.pos++;
+    return c;
+}
+
+// Chars of a value that may span chunks
+struct token
+{
+    char *data;
+    size_t len, cap;
+    char stack[128];
+};
+
+static void token_init(struct token *t)
+{
+    t->data = t->stack;
+    t->len = 0;
+    t->cap = sizeof(t->stack);
+}
+
+static void token_append(struct token *t, const char *bytes, size_t len)
+{
+    if (t->len + len >= t->cap)
+    {
+        size_t cap = t->cap;
+        char *grown;
+        while (t->len + len >= cap)
+            cap *= 2;
+        if (cap > INT32_MAX || (grown = malloc(cap)) == NULL)
+        {
+            fputs("spc runtime: input value too long\n", stderr);
+            abort();
+        }
+        memcpy(grown, t->data, t->len);
+        if (t->data != t->stack)
+            free(t->data);
+        t->data = grown;
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, bytes, len);
+    t->len += len;
+    t->data[t->len] = '\0';
+}
+
+static void token_free(struct token *t)
+{
+    if (t->data != t->stack)
+        free(t->data);
+}
+
+// Appends the current char to t and returns the next one
+static int token_next(struct token *t)
+{
+    token_append(t, in.pos++, 1);
+    return in_peek();
+}
+
+void spc_read_int(int32_t *dst)
+{
+    int c = in_skip_space(), negative = 0;
+    uint32_t value = 0;
+    if (c == '+' || c == '-')
+    {
+        negative = c == '-';
+        in.pos++;
+        c = in_peek();
+    }
+    if (c == EOF || !isdigit(c))
+        return;
+    // wraps around on overflow
+    do
+    {
+        value = value * 10 + (uint32_t)(c - '0');
+        in.pos++;
+    } while ((c = in_peek()) != EOF && isdigit(c));
+    *dst = (int32_t)(negative ? 0u - value : value);
+}
+
+void spc_read_real(double *dst)
+{
+    // Exact powers of ten: a mantissa below 2^53 scaled by one of them is rounded once,
+    // correctly (Clinger's fast path). Everything else goes to strtod.
+    static const double powers_of_10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    struct token t;
+    uint64_t mantissa = 0;
+    int32_t digits = 0, exp10 = 0, exact = 1, seen = 0, negative = 0;
+    double value;
+    int c = in_skip_space();
+    token_init(&t);
+    if (c == '+' || c == '-')
+    {
+        negative = c == '-';
+        c = token_next(&t);
+    }
+    // up to 19 significant digits go to the mantissa, leading zeros only move the point
+    for (; c != EOF && isdigit(c); c = token_next(&t))
+    {
+        seen = 1;
+        if (digits < 19 && (mantissa > 0 || c != '0'))
+        {
+            mantissa = mantissa * 10 + (uint64_t)(c - '0');
+            digits++;
+        }
+        else if (mantissa > 0)
+        {
+            exp10++;
+            exact = 0;
+        }
+    }
+    if (c == '.')
+    {
+        for (c = token_next(&t); c != EOF && isdigit(c); c = token_next(&t))
+        {
+            seen = 1;
+            if (digits < 19 && (mantissa > 0 || c != '0'))
+            {
+                mantissa = mantissa * 10 + (uint64_t)(c - '0');
+                digits++;
+                exp10--;
+            }
+            else if (mantissa == 0)
+                exp10--;
+            else
+                exact = 0;
+        }
+    }
+    if (!seen)
+    {
+        token_free(&t);
+        return;
+    }
+    if (c == 'e' || c == 'E')
+    {
+        int32_t exponent = 0, sign = 1;
+        c = token_next(&t);
+        if (c == '+' || c == '-')
+        {
+            sign = c == '-' ? -1 : 1;
+            c = token_next(&t);
+        }
+        for (; c != EOF && isdigit(c); c = token_next(&t))
+            if (exponent < 100000)
+                exponent = exponent * 10 + (c - '0');
+        exp10 += sign * exponent;
+    }
+    if (mantissa == 0)
+        value = negative ? -0.0 : 0.0;
+    else if (exact && mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22)
+    {
+        value = exp10 < 0 ? (double)mantissa / powers_of_10[-exp10] : (double)mantissa * powers_of_10[exp10];
+        if (negative)
+            value = -value;
+    }
+    else
+        value = strtod(t.data, NULL);
+    token_free(&t);
+    *dst = value;
+}
+
+void spc_read_char(char *dst)
+{
+    int c = in_peek();
+    if (c == EOF)
+        return;
+    *dst = (char)c;
+    in.pos++;
+}
+
+void spc_str_read(spc_str **dst, int32_t line)
+{
+    struct token t;
+    spc_str *old = *dst;
+    int c = line ? in_peek() : in_skip_space();
+    token_init(&t);
+    while (c != EOF)
+    {
+        const char *p = in.pos;
+        while (p < in.end && (line ? *p != '\n' : !isspace((unsigned char)*p)))
+            p++;
+        if (p < in.end && t.len == 0)
+        {
+            // the common case, a value within the buffer, is copied once
+            if (p == in.pos)
+                break;
+            *dst = spc_str_from(in.pos, (int32_t)(p - in.pos));
+            spc_str_release(old);
+            in.pos = p;
+            return;
+        }
+        token_append(&t, in.pos, (size_t)(p - in.pos));
+        in.pos = p;
+        if (p < in.end)
+            break;
+        c = in_peek();
+    }
+    // the delimiter stays in the input, as with scanf
+    if (t.len > 0)
+    {
+        *dst = spc_str_from(t.data, (int32_t)t.len);
+        spc_str_release(old);
+    }
+    token_free(&t);
+}
+
+void spc_readln(void)
+{
+    while (in_peek() != EOF)
+    {
+        const char *newline = memchr(in.pos, '\n', (size_t)(in.end - in.pos));
+        if (newline != NULL)
+        {
+            in.pos = newline + 1;
+            return;
+        }
+        in.pos = in.end;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef SPCRT_H
+#define SPCRT_H
+
+/*
+ * Runtime library of the programs spc compiles (libspcrt). Generated code calls these
+ * functions directly, so their names and the layout of spc_str are part of the ABI:
+ * changing either needs the matching change in CodegenContext.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A Pascal string, referenced by pointer. The null pointer is the empty string.
+ * Strings are shared between variables and copied on the first write to a shared one.
+ * refs < 0 marks an immortal string (literals and consts, emitted by the compiler into
+ * read-only data), which is never counted, written or freed.
+ * data holds len bytes followed by a NUL, so it can be handed to C as is.
+ */
+typedef struct spc_str
+{
+    int32_t refs;
+    int32_t len;
+    int32_t cap;
+    char data[];
+} spc_str;
+
+void spc_str_retain(spc_str *s);
+void spc_str_release(spc_str *s);
+/* *dst := src, counting the new reference before dropping the old one */
+void spc_str_assign(spc_str **dst, spc_str *src);
+/* Address of the char (*s)[index] about to be written, after making *s a string no other
+ * variable refers to. An index outside of the string's length stops the program with a
+ * runtime error; the length never changes. */
+char *spc_str_at(spc_str **s, int32_t index);
+/* concat(): the count parts joined into one new string, or a new reference to the only non-empty part */
+spc_str *spc_str_concat(spc_str *const *parts, int32_t count);
+/* str(): new strings holding the value as write prints it */
+spc_str *spc_str_of_int(int32_t value);
+spc_str *spc_str_of_char(char value);
+spc_str *spc_str_of_real(double value);
+const char *spc_str_cstr(const spc_str *s);
+
+/*
+ * write/writeln. The output is buffered per thread and reaches stdout when the buffer
+ * fills up and on spc_flush, which the program calls before reading and before main returns.
+ * Each value is right-aligned in a field of width chars, and never cut when it is longer.
+ * write_real prints like printf("%.*f"), with precision 6 when the program gives none.
+ */
+void spc_write_int(int32_t value, int32_t width);
+void spc_write_real(double value, int32_t width, int32_t precision);
+void spc_write_char(char value, int32_t width);
+void spc_write_str(const spc_str *s, int32_t width);
+void spc_flush(void);
+
+/*
+ * read/readln from stdin, parsed without scanf from a buffer of the input. Each reader
+ * skips leading whitespace, except read_char and the line form of str_read, and leaves the
+ * char after the value in the input. Like scanf, they leave *dst alone if no value is read.
+ * They are not thread-safe: only one thread of the program may read.
+ */
+/* An optionally signed decimal integer, wrapping around on overflow */
+void spc_read_int(int32_t *dst);
+/* A decimal real: optional sign, digits with an optional point, optional exponent */
+void spc_read_real(double *dst);
+void spc_read_char(char *dst);
+/* A whitespace delimited word, or with line the rest of the line */
+void spc_str_read(spc_str **dst, int32_t line);
+/* Skips the rest of the line, the newline included */
+void spc_readln(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
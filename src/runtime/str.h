@@ -0,0 +1,11 @@
+#ifndef SPCRT_STR_H
+#define SPCRT_STR_H
+
+/* Strings made by the runtime itself. Not part of the ABI. */
+
+#include "spcrt.h"
+
+/* A new string holding the len bytes, or NULL (the empty string) if len is 0 */
+spc_str *spc_str_from(const char *bytes, int32_t len);
+
+#endif
@@ -0,0 +1,126 @@
+#include "str.h"
+#include "format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static spc_str *str_alloc(int32_t cap)
+{
+    spc_str *s = malloc(sizeof(spc_str) + (size_t)cap + 1);
+    if (s == NULL)
+    {
+        fputs("spc runtime: out of memory\n", stderr);
+        abort();
+    }
+    s->refs = 1;
+    s->len = 0;
+    s->cap = cap;
+    s->data[0] = '\0';
+    return s;
+}
+
+spc_str *spc_str_from(const char *bytes, int32_t len)
+{
+    spc_str *s;
+    if (len == 0)
+        return NULL;
+    s = str_alloc(len);
+    memcpy(s->data, bytes, (size_t)len);
+    s->data[len] = '\0';
+    s->len = len;
+    return s;
+}
+
+void spc_str_retain(spc_str *s)
+{
+    if (s != NULL && s->refs > 0)
+        __atomic_add_fetch(&s->refs, 1, __ATOMIC_RELAXED);
+}
+
+void spc_str_release(spc_str *s)
+{
+    if (s != NULL && s->refs > 0 && __atomic_sub_fetch(&s->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        free(s);
+}
+
+void spc_str_assign(spc_str **dst, spc_str *src)
+{
+    spc_str *old = *dst;
+    spc_str_retain(src);
+    *dst = src;
+    spc_str_release(old);
+}
+
+char *spc_str_at(spc_str **s, int32_t index)
+{
+    spc_str *old = *s;
+    if (old == NULL || index < 0 || index >= old->len)
+    {
+        // what the program wrote so far comes before the error
+        spc_flush();
+        fprintf(stderr, "spc runtime: string index %d out of range, the length is %d\n", (int)index, old == NULL ? 0 : (int)old->len);
+        abort();
+    }
+    if (old->refs != 1)
+    {
+        *s = spc_str_from(old->data, old->len);
+        spc_str_release(old);
+    }
+    return &(*s)->data[index];
+}
+
+spc_str *spc_str_concat(spc_str *const *parts, int32_t count)
+{
+    spc_str *s, *last = NULL;
+    int64_t len = 0;
+    int32_t i, nonempty = 0;
+    for (i = 0; i < count; i++)
+        if (parts[i] != NULL)
+        {
+            len += parts[i]->len;
+            last = parts[i];
+            nonempty++;
+        }
+    if (nonempty <= 1)
+    {
+        spc_str_retain(last);
+        return last;
+    }
+    if (len > INT32_MAX)
+    {
+        fputs("spc runtime: string too long in concat()\n", stderr);
+        abort();
+    }
+    s = str_alloc((int32_t)len);
+    for (i = 0; i < count; i++)
+        if (parts[i] != NULL)
+        {
+            memcpy(s->data + s->len, parts[i]->data, (size_t)parts[i]->len);
+            s->len += parts[i]->len;
+        }
+    s->data[s->len] = '\0';
+    return s;
+}
+
+spc_str *spc_str_of_int(int32_t value)
+{
+    char buf[SPC_FMT_INT_SIZE];
+    return spc_str_from(buf, spc_fmt_int(buf, value));
+}
+
+spc_str *spc_str_of_char(char value)
+{
+    return spc_str_from(&value, 1);
+}
+
+spc_str *spc_str_of_real(double value)
+{
+    char buf[SPC_FMT_REAL_SIZE + 1];
+    return spc_str_from(buf, spc_fmt_real(buf, value, 6));
+}
+
+const char *spc_str_cstr(const spc_str *s)
+{
+    return s == NULL ? "" : s->data;
+}
@@ -27,7 +27,7 @@ bool ASTopt::cmp(T lhs, T rhs, BinaryOp op)
     }
 }
 
-int ASTopt::computeBoolExpr(const std::shared_ptr<ExprNode>& expr)
+int ASTopt::computeBoolExpr(ExprNode *expr)
 /*
 Return val:
     0: false
@@ -42,7 +42,7 @@ Return val:
 }
 
 
-std::pair<Type, ASTopt::ExprVal> ASTopt::computeExpr(const std::shared_ptr<ExprNode>& expr)
+std::pair<Type, ASTopt::ExprVal> ASTopt::computeExpr(ExprNode *expr)
 {
     ASTopt::ExprVal ret;
     if (is_ptr_of<ConstValueNode>(expr))
@@ -313,7 +313,7 @@ std::pair<Type, ASTopt::ExprVal> ASTopt::computeExpr(const std::shared_ptr<ExprN
     return std::make_pair(Type::Unknown, ret);
 }
 
-void ASTopt::opt(std::shared_ptr<CompoundStmtNode> &stmt)
+void ASTopt::opt(CompoundStmtNode *&stmt)
 {
     auto &stmt_list = stmt->getChildren();
     for (auto itr = stmt_list.begin(); itr != stmt_list.end(); itr++)
@@ -326,7 +326,7 @@ void ASTopt::opt(std::shared_ptr<CompoundStmtNode> &stmt)
             auto res = computeExpr(rhs);
             if (res.first != Type::Unknown)
             {
-                std::shared_ptr<ConstValueNode> val;
+                ConstValueNode *val;
                 switch (res.first)
                 {
                 case Type::Bool:
@@ -411,7 +411,7 @@ void ASTopt::opt(std::shared_ptr<CompoundStmtNode> &stmt)
     }
 }
 
-void ASTopt::operator()(std::shared_ptr<BaseRoutineNode> prog)
+void ASTopt::operator()(BaseRoutineNode *prog)
 {
     for (auto &routine : prog->header->subroutineList->getChildren())
         this->operator()(cast_node<BaseRoutineNode>(routine));
@@ -19,12 +19,12 @@ namespace spc
         };
         ASTopt() = default;
         ~ASTopt() = default;
-        void operator()(std::shared_ptr<BaseRoutineNode> prog);
+        void operator()(BaseRoutineNode *prog);
     private:
-        int computeBoolExpr(const std::shared_ptr<ExprNode>& expr);
-        std::pair<Type, ExprVal> computeExpr(const std::shared_ptr<ExprNode>& expr);
+        int computeBoolExpr(ExprNode *expr);
+        std::pair<Type, ExprVal> computeExpr(ExprNode *expr);
         template<typename T> bool cmp(T lhs, T rhs, BinaryOp op);
-        void opt(std::shared_ptr<CompoundStmtNode> &stmt);
+        void opt(CompoundStmtNode *&stmt);
     };
 
 
@@ -6,7 +6,7 @@
 
 using namespace spc;
 
-void spc::ASTvis::travAST(const std::shared_ptr<ProgramNode>& prog)
+void spc::ASTvis::travAST(BaseRoutineNode *prog)
 {
 
     of << texHeader;
@@ -18,13 +18,13 @@ void spc::ASTvis::travAST(const std::shared_ptr<ProgramNode>& prog)
     return;
 }
 
-int spc::ASTvis::travProgram(const std::shared_ptr<spc::ProgramNode>& prog)
+int spc::ASTvis::travProgram(spc::BaseRoutineNode *prog)
 {
-    of << "\\node {Program: " << prog->getName() << "}\n";
-    return travRoutineBody(spc::cast_node<spc::BaseRoutineNode>(prog));
+    of << "\\node {" << (spc::is_ptr_of<spc::UnitNode>(prog) ? "Unit: " : "Program: ") << prog->getName() << "}\n";
+    return travRoutineBody(prog);
 }
 
-int spc::ASTvis::travRoutineBody(const std::shared_ptr<spc::BaseRoutineNode>& prog)
+int spc::ASTvis::travRoutineBody(spc::BaseRoutineNode *prog)
 {
     int tmp = 0, lines = 6;
     of << "child { node {CONST}";
@@ -65,14 +65,14 @@ int spc::ASTvis::travRoutineBody(const std::shared_ptr<spc::BaseRoutineNode>& pr
     return lines;
 }
 
-int spc::ASTvis::travCONST(const std::shared_ptr<spc::ConstDeclList>& const_declListAST)
+int spc::ASTvis::travCONST(spc::ConstDeclList *const_declListAST)
 {
-    std::list<std::shared_ptr<ConstDeclNode>>& constList(const_declListAST->getChildren());
+    std::list<ConstDeclNode *>& constList(const_declListAST->getChildren());
     int lines = constList.size();
 
     for (auto &p : constList) {
         of << "child { node {";
-        of << p->name->name << " : ";
+        of << p->name->name.str() << " : ";
         switch (p->val->type) {
             case spc::Type::Void    : of << "VOID"   ; break;
             case spc::Type::Array   : of << "ARRAY"  ; break;
@@ -89,14 +89,14 @@ int spc::ASTvis::travCONST(const std::shared_ptr<spc::ConstDeclList>& const_decl
     return lines;
 }
 
-int spc::ASTvis::travTYPE(const std::shared_ptr<spc::TypeDeclList>& type_declListAST)
+int spc::ASTvis::travTYPE(spc::TypeDeclList *type_declListAST)
 {
-    std::list<std::shared_ptr<TypeDeclNode>>& typeList(type_declListAST->getChildren());
+    std::list<TypeDeclNode *>& typeList(type_declListAST->getChildren());
     int lines = typeList.size();
 
     for (auto &p : typeList) {
         of << "child { node {";
-        of << p->name->name << " : ";
+        of << p->name->name.str() << " : ";
         switch (p->type->type) {
             case spc::Type::Void    : of << "VOID"   ; break;
             case spc::Type::Array   : of << "ARRAY"  ; break;
@@ -112,14 +112,14 @@ int spc::ASTvis::travTYPE(const std::shared_ptr<spc::TypeDeclList>& type_declLis
     }
     return lines;
 }
-int spc::ASTvis::travVAR(const std::shared_ptr<spc::VarDeclList>& var_declListAST)
+int spc::ASTvis::travVAR(spc::VarDeclList *var_declListAST)
 {
-    std::list<std::shared_ptr<VarDeclNode>>& varList(var_declListAST->getChildren());
+    std::list<VarDeclNode *>& varList(var_declListAST->getChildren());
     int lines = varList.size();
 
     for (auto &p : varList) {
         of << "child { node {";
-        of << p->name->name << " : ";
+        of << p->name->name.str() << " : ";
         switch (p->type->type) {
             case spc::Type::Void    : of << "VOID"   ; break;
             case spc::Type::Array   : of << "ARRAY"  ; break;
@@ -137,9 +137,9 @@ int spc::ASTvis::travVAR(const std::shared_ptr<spc::VarDeclList>& var_declListAS
     return lines;
 }
 
-int spc::ASTvis::travSubprocList(const std::shared_ptr<spc::RoutineList>& subProc_declListAST)
+int spc::ASTvis::travSubprocList(spc::RoutineList *subProc_declListAST)
 {
-    std::list<std::shared_ptr<spc::RoutineNode>>& progList(subProc_declListAST->getChildren());
+    std::list<spc::RoutineNode *>& progList(subProc_declListAST->getChildren());
     int tmp = 0, lines = progList.size();
 
     for (auto &p : progList) {
@@ -150,7 +150,7 @@ int spc::ASTvis::travSubprocList(const std::shared_ptr<spc::RoutineList>& subPro
     return lines;
 }
 
-int spc::ASTvis::travSubproc(const std::shared_ptr<spc::RoutineNode>& subProc_AST)
+int spc::ASTvis::travSubproc(spc::RoutineNode *subProc_AST)
 {
     int lines = 0;
     of << "child { node {";
@@ -173,12 +173,14 @@ int spc::ASTvis::travSubproc(const std::shared_ptr<spc::RoutineNode>& subProc_AS
         }
     }
 
-    std::list<std::shared_ptr<ParamNode>>& paramAsts
+    std::list<ParamNode *>& paramAsts
             = subProc_AST->params->getChildren();
     {
         of << "$ ---- $PARAMS: ";
         for (auto &p : paramAsts) {
-            of << p->name->name << " $-$ ";
+            if (p->mode == spc::ParamMode::ByVar) of << "VAR ";
+            else if (p->mode == spc::ParamMode::ByConst) of << "CONST ";
+            of << p->name->name.str() << " $-$ ";
             switch (p->type->type) {
                 case spc::Type::Void    : of << "VOID"   ; break;
                 case spc::Type::Array   : of << "ARRAY"  ; break;
@@ -198,10 +200,10 @@ int spc::ASTvis::travSubproc(const std::shared_ptr<spc::RoutineNode>& subProc_AS
     return lines;
 }
 
-int spc::ASTvis::travCompound(const std::shared_ptr<spc::CompoundStmtNode>& compound_declListAST)
+int spc::ASTvis::travCompound(spc::CompoundStmtNode *compound_declListAST)
 {
     if (compound_declListAST == nullptr) return 0;
-    std::list<std::shared_ptr<spc::StmtNode>>& stmtList(compound_declListAST->getChildren());
+    std::list<spc::StmtNode *>& stmtList(compound_declListAST->getChildren());
     int tmp = 0, lines = stmtList.size();
     for (auto &p : stmtList) {
         tmp = 0;
@@ -245,10 +247,10 @@ int spc::ASTvis::travCompound(const std::shared_ptr<spc::CompoundStmtNode>& comp
     return lines;
 }
 
-int spc::ASTvis::travStmt(const std::shared_ptr<spc::CaseStmtNode>&p_stmp)
+int spc::ASTvis::travStmt(spc::CaseStmtNode *p_stmp)
 {
     if (p_stmp == nullptr) return 0;
-    std::list<std::shared_ptr<spc::CaseBranchNode>>& stmtList(p_stmp->branches);
+    std::list<spc::CaseBranchNode *>& stmtList(p_stmp->branches);
     int tmp = 0, lines = stmtList.size();
     of << "child { node {CASE Statment case expr}\n";
     tmp = travExpr(p_stmp->expr);
@@ -275,14 +277,14 @@ int spc::ASTvis::travStmt(const std::shared_ptr<spc::CaseStmtNode>&p_stmp)
     return lines;
 }
 
-int spc::ASTvis::travStmt(const std::shared_ptr<spc::StmtNode>&p_stmp)
+int spc::ASTvis::travStmt(spc::StmtNode *p_stmp)
 {
     if (p_stmp == nullptr) return 0;
     of << "child { node {Base Statment}}\n";
     return 0;
 }
 // * done
-int spc::ASTvis::travStmt(const std::shared_ptr<spc::IfStmtNode>&p_stmp)
+int spc::ASTvis::travStmt(spc::IfStmtNode *p_stmp)
 {
     if (p_stmp == nullptr) return 0;
     int tmp = 0, lines = 3;
@@ -307,7 +309,7 @@ int spc::ASTvis::travStmt(const std::shared_ptr<spc::IfStmtNode>&p_stmp)
 
     return lines;
 }
-int spc::ASTvis::travStmt(const std::shared_ptr<spc::WhileStmtNode>&p_stmp)
+int spc::ASTvis::travStmt(spc::WhileStmtNode *p_stmp)
 {
     if (p_stmp == nullptr) return 0;
     int tmp = 0, lines = 2;
@@ -323,12 +325,12 @@ int spc::ASTvis::travStmt(const std::shared_ptr<spc::WhileStmtNode>&p_stmp)
     lines += tmp; tmp = 0;
     return lines;
 }
-int spc::ASTvis::travStmt(const std::shared_ptr<spc::ForStmtNode>&p_stmp)
+int spc::ASTvis::travStmt(spc::ForStmtNode *p_stmp)
 {
     if (p_stmp == nullptr) return 0;
     int tmp = 0, lines = 0;
     of << "child { node {FOR Expr: ";
-    of << p_stmp->id->name << " }\n ";
+    of << p_stmp->id->name.str() << " }\n ";
 
     tmp += travExpr(p_stmp->init_val);
     // of << texNone;
@@ -345,7 +347,7 @@ int spc::ASTvis::travStmt(const std::shared_ptr<spc::ForStmtNode>&p_stmp)
 
     return lines;
 }
-int spc::ASTvis::travStmt(const std::shared_ptr<spc::RepeatStmtNode>&p_stmp)
+int spc::ASTvis::travStmt(spc::RepeatStmtNode *p_stmp)
 {
     if (p_stmp == nullptr) return 0;
     int tmp = 0, lines = 2;
@@ -362,7 +364,7 @@ int spc::ASTvis::travStmt(const std::shared_ptr<spc::RepeatStmtNode>&p_stmp)
     // of << "}\n";
     return lines;
 }
-int spc::ASTvis::travStmt(const std::shared_ptr<spc::ProcStmtNode>&p_stmp)
+int spc::ASTvis::travStmt(spc::ProcStmtNode *p_stmp)
 {
     if (p_stmp == nullptr) return 0;
     int tmp = 0, lines = 0;
@@ -373,7 +375,7 @@ int spc::ASTvis::travStmt(const std::shared_ptr<spc::ProcStmtNode>&p_stmp)
     of << "}\n}\n";
     return lines;
 }
-int spc::ASTvis::travStmt(const std::shared_ptr<spc::AssignStmtNode>&p_stmp)
+int spc::ASTvis::travStmt(spc::AssignStmtNode *p_stmp)
 {
     if (p_stmp == nullptr) return 0;
     int tmp = 2, lines = 0;
@@ -387,7 +389,7 @@ int spc::ASTvis::travStmt(const std::shared_ptr<spc::AssignStmtNode>&p_stmp)
     return lines;
 }
 
-int spc::ASTvis::travExpr(const std::shared_ptr<ExprNode>& expr)
+int spc::ASTvis::travExpr(ExprNode *expr)
 {
     int tmp = 0, lines = 0;
     if (spc::is_ptr_of<spc::BinaryExprNode>(expr))
@@ -410,7 +412,7 @@ int spc::ASTvis::travExpr(const std::shared_ptr<ExprNode>& expr)
     return lines;
 }
 
-int spc::ASTvis::travExpr(const std::shared_ptr<BinaryExprNode>& expr)
+int spc::ASTvis::travExpr(BinaryExprNode *expr)
 {
     if (expr == nullptr) return 0;
     int tmp = 0, lines = 2;
@@ -446,7 +448,7 @@ int spc::ASTvis::travExpr(const std::shared_ptr<BinaryExprNode>& expr)
 
     return lines;
 }
-int spc::ASTvis::travExpr(const std::shared_ptr<spc::ConstValueNode>& expr)
+int spc::ASTvis::travExpr(spc::ConstValueNode *expr)
 {
     if (expr == nullptr) return 0;
     int tmp = 0, lines = 0;
@@ -457,18 +459,18 @@ int spc::ASTvis::travExpr(const std::shared_ptr<spc::ConstValueNode>& expr)
     of << "}\n}\n";
     return lines;
 }
-int spc::ASTvis::travExpr(const std::shared_ptr<spc::IdentifierNode>& expr)
+int spc::ASTvis::travExpr(spc::IdentifierNode *expr)
 {
     if (expr == nullptr) return 0;
     int tmp = 0, lines = 0;
-    of << "child { node {ID: " << expr->name;
+    of << "child { node {ID: " << expr->name.str();
     // tmp = travExpr(p_stmp->expr);
     for (int i=0; i<tmp; ++i) of << texNone;
     lines += tmp;
     of << "}\n}\n";
     return lines;
 }
-int spc::ASTvis::travExpr(const std::shared_ptr<spc::ArrayRefNode>& expr)
+int spc::ASTvis::travExpr(spc::ArrayRefNode *expr)
 {
     if (expr == nullptr) return 0;
     int tmp = 0, lines = 0;
@@ -479,7 +481,7 @@ int spc::ASTvis::travExpr(const std::shared_ptr<spc::ArrayRefNode>& expr)
     of << "}\n}\n";
     return lines;
 }
-int spc::ASTvis::travExpr(const std::shared_ptr<spc::RecordRefNode>& expr)
+int spc::ASTvis::travExpr(spc::RecordRefNode *expr)
 {
     if (expr == nullptr) return 0;
     int tmp = 0, lines = 0;
@@ -490,24 +492,24 @@ int spc::ASTvis::travExpr(const std::shared_ptr<spc::RecordRefNode>& expr)
     of << "}\n}\n";
     return lines;
 }
-int spc::ASTvis::travExpr(const std::shared_ptr<spc::ProcNode>& expr)
+int spc::ASTvis::travExpr(spc::ProcNode *expr)
 {
     if (expr == nullptr) return 0;
     int tmp = 0, lines = 0;
     return lines;
 }
-int spc::ASTvis::travExpr(const std::shared_ptr<spc::CustomProcNode>& expr)
+int spc::ASTvis::travExpr(spc::CustomProcNode *expr)
 {
     if (expr == nullptr) return 0;
     int tmp = 0, lines = 0;
 
     of << "child { node {CustomFunc: ";
-    of << expr->name->name;
+    of << expr->name->name.str();
     of << "}\n";
     of << "}\n";
     return lines;
 }
-int spc::ASTvis::travExpr(const std::shared_ptr<spc::SysProcNode>& expr)
+int spc::ASTvis::travExpr(spc::SysProcNode *expr)
 {
     if (expr == nullptr) return 0;
     int tmp = 0, lines = 0;
@@ -17,38 +17,39 @@ namespace spc {
             }
         }
         ~ASTvis() = default;
-        void travAST(const std::shared_ptr<ProgramNode>& prog);
+        // prog is a ProgramNode or a UnitNode
+        void travAST(BaseRoutineNode *prog);
 
     private:
-        int travProgram(const std::shared_ptr<ProgramNode>& prog);
-        int travRoutineBody(const std::shared_ptr<BaseRoutineNode>& prog);
+        int travProgram(BaseRoutineNode *prog);
+        int travRoutineBody(BaseRoutineNode *prog);
 
-        int travCONST(const std::shared_ptr<ConstDeclList>& const_declListAST);
-        int travTYPE(const std::shared_ptr<TypeDeclList>& type_declListAST);
-        int travVAR(const std::shared_ptr<VarDeclList>& var_declListAST);
-        int travSubprocList(const std::shared_ptr<RoutineList>& subProc_declListAST);
-        int travSubproc(const std::shared_ptr<RoutineNode>& subProc_AST);
-        int travCompound(const std::shared_ptr<CompoundStmtNode>& compound_declListAST);
+        int travCONST(ConstDeclList *const_declListAST);
+        int travTYPE(TypeDeclList *type_declListAST);
+        int travVAR(VarDeclList *var_declListAST);
+        int travSubprocList(RoutineList *subProc_declListAST);
+        int travSubproc(RoutineNode *subProc_AST);
+        int travCompound(CompoundStmtNode *compound_declListAST);
 
-        int travStmt(const std::shared_ptr<StmtNode>&p_stmp);
-        int travStmt(const std::shared_ptr<IfStmtNode>&p_stmp);
-        int travStmt(const std::shared_ptr<WhileStmtNode>&p_stmp);
-        int travStmt(const std::shared_ptr<ForStmtNode>&p_stmp);
-        int travStmt(const std::shared_ptr<RepeatStmtNode>&p_stmp);
-        int travStmt(const std::shared_ptr<ProcStmtNode>&p_stmp);
-        int travStmt(const std::shared_ptr<AssignStmtNode>&p_stmp);
-        int travStmt(const std::shared_ptr<CaseStmtNode>&p_stmp);
+        int travStmt(StmtNode *p_stmp);
+        int travStmt(IfStmtNode *p_stmp);
+        int travStmt(WhileStmtNode *p_stmp);
+        int travStmt(ForStmtNode *p_stmp);
+        int travStmt(RepeatStmtNode *p_stmp);
+        int travStmt(ProcStmtNode *p_stmp);
+        int travStmt(AssignStmtNode *p_stmp);
+        int travStmt(CaseStmtNode *p_stmp);
 
-        int travExpr(const std::shared_ptr<ExprNode>& expr);
-        int travExpr(const std::shared_ptr<BinaryExprNode>& expr);
-        int travExpr(const std::shared_ptr<spc::IdentifierNode>& expr);
-        int travExpr(const std::shared_ptr<spc::ConstValueNode>& expr);
-        // int travExpr(const std::shared_ptr<UnaryExprNode>& expr);
-        int travExpr(const std::shared_ptr<ArrayRefNode>& expr);
-        int travExpr(const std::shared_ptr<RecordRefNode>& expr);
-        int travExpr(const std::shared_ptr<ProcNode>& expr);
-        int travExpr(const std::shared_ptr<CustomProcNode>& expr);
-        int travExpr(const std::shared_ptr<SysProcNode>& expr);
+        int travExpr(ExprNode *expr);
+        int travExpr(BinaryExprNode *expr);
+        int travExpr(spc::IdentifierNode *expr);
+        int travExpr(spc::ConstValueNode *expr);
+        // int travExpr(UnaryExprNode *expr);
+        int travExpr(ArrayRefNode *expr);
+        int travExpr(RecordRefNode *expr);
+        int travExpr(ProcNode *expr);
+        int travExpr(CustomProcNode *expr);
+        int travExpr(SysProcNode *expr);
 
         int node_cnt    = 0;
         int subproc_cnt = 0;
@@ -0,0 +1,174 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <ostream>
+#include <sys/file.h>
+#include <unistd.h>
+#include <utime.h>
+#include <vector>
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+
+using namespace spc;
+
+spc::CompileCache::CompileCache(const std::string &dir, uint64_t maxBytes)
+    : dir(dir), maxBytes(maxBytes), _hits(0), _misses(0)
+{
+}
+
+bool spc::CompileCache::init(std::string &error)
+{
+    if (auto ec = llvm::sys::fs::create_directories(dir))
+    {
+        error = "Could not create cache directory " + dir + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+std::string spc::CompileCache::key(const std::string &input, const std::string &flags, const std::vector<std::string> &deps)
+{
+    auto buffer = llvm::MemoryBuffer::getFile(input);
+    if (!buffer) return "";
+
+    llvm::MD5 hash;
+    hash.update(SPC_VERSION);
+    hash.update(LLVM_VERSION_STRING);
+    hash.update(flags);
+    hash.update((*buffer)->getBuffer());
+    for (auto &dep : deps)
+    {
+        auto depBuffer = llvm::MemoryBuffer::getFile(dep);
+        if (!depBuffer) return "";
+        hash.update(dep);
+        hash.update((*depBuffer)->getBuffer());
+    }
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+    return result.digest().str().str();
+}
+
+std::string spc::CompileCache::entryPath(const std::string &key) const
+{
+    llvm::SmallString<128> path(dir);
+    llvm::sys::path::append(path, key);
+    return path.str().str();
+}
+
+// Copies from to to through a unique temporary, so that the rename publishes it atomically
+static bool publish(const std::string &from, const std::string &to)
+{
+    llvm::SmallString<128> tmp;
+    int fd;
+    if (llvm::sys::fs::createUniqueFile(to + "-%%%%%%.tmp", fd, tmp))
+        return false;
+    close(fd);
+    if (llvm::sys::fs::copy_file(from, tmp) || llvm::sys::fs::rename(tmp, to))
+    {
+        llvm::sys::fs::remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+// Like writing an interface file, leaves to alone, modification time included, if it holds the same bytes
+static bool publishIfChanged(const std::string &from, const std::string &to)
+{
+    auto fromBuffer = llvm::MemoryBuffer::getFile(from);
+    auto toBuffer = llvm::MemoryBuffer::getFile(to);
+    if (fromBuffer && toBuffer && (*fromBuffer)->getBuffer() == (*toBuffer)->getBuffer())
+        return true;
+    return publish(from, to);
+}
+
+bool spc::CompileCache::fetch(const std::string &key, const std::string &output, const std::string &interface)
+{
+    auto path = entryPath(key);
+    auto interfacePath = entryPath(key + ".spi");
+    // The entry may be evicted by another process between the check and the copy, which is just a miss
+    if (!llvm::sys::fs::exists(path) || (!interface.empty() && !llvm::sys::fs::exists(interfacePath))
+        || llvm::sys::fs::copy_file(path, output) || (!interface.empty() && !publishIfChanged(interfacePath, interface)))
+    {
+        ++_misses;
+        return false;
+    }
+    // Entries are evicted by modification time, so a hit makes the entry the most recently used
+    utime(path.c_str(), nullptr);
+    if (!interface.empty())
+        utime(interfacePath.c_str(), nullptr);
+    ++_hits;
+    return true;
+}
+
+void spc::CompileCache::store(const std::string &key, const std::string &output, const std::string &interface)
+{
+    if (!publish(output, entryPath(key)) || (!interface.empty() && !publish(interface, entryPath(key + ".spi"))))
+        return;
+    evict();
+}
+
+void spc::CompileCache::evict()
+{
+    struct Entry
+    {
+        std::string path;
+        uint64_t size;
+        llvm::sys::TimePoint<> mtime;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), end; it != end && !ec; it.increment(ec))
+    {
+        auto name = llvm::sys::path::filename(it->path());
+        // Skip temporaries of stores in progress and the statistics file
+        if (name.endswith(".tmp") || name == "stats") continue;
+        llvm::sys::fs::file_status status;
+        if (llvm::sys::fs::status(it->path(), status)) continue;
+        entries.push_back({it->path(), status.getSize(), status.getLastModificationTime()});
+        total += status.getSize();
+    }
+    if (total <= maxBytes) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.mtime < b.mtime; });
+    for (auto &e : entries)
+    {
+        if (total <= maxBytes) break;
+        // Another process may have removed it already
+        llvm::sys::fs::remove(e.path);
+        total -= e.size;
+    }
+}
+
+void spc::CompileCache::printStats(std::ostream &os)
+{
+    unsigned long totalHits = _hits, totalMisses = _misses;
+    // Totals across runs; the lock serializes concurrent spc processes updating them
+    auto path = entryPath("stats");
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0 && flock(fd, LOCK_EX) == 0)
+    {
+        char buf[64] = {0};
+        unsigned long oldHits = 0, oldMisses = 0;
+        if (read(fd, buf, sizeof(buf) - 1) > 0 && sscanf(buf, "%lu %lu", &oldHits, &oldMisses) == 2)
+        {
+            totalHits += oldHits;
+            totalMisses += oldMisses;
+        }
+        int len = snprintf(buf, sizeof(buf), "%lu %lu\n", totalHits, totalMisses);
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, buf, len, 0) != len)
+            os << "Warning: could not update " << path << std::endl;
+        flock(fd, LOCK_UN);
+    }
+    if (fd >= 0) close(fd);
+
+    os << "Cache " << dir << ": " << _hits << " hits, " << _misses << " misses this run; "
+       << totalHits << " hits, " << totalMisses << " misses in total" << std::endl;
+}
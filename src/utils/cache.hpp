@@ -0,0 +1,55 @@
+#ifndef __CACHE__H__
+#define __CACHE__H__
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Part of every cache key; bump it whenever the generated code changes
+#define SPC_VERSION "0.13.0"
+
+namespace spc
+{
+
+    // On-disk cache of compile outputs (--cache-dir), addressed by a hash of the source and the flags.
+    // Entries are published with a rename so that concurrent spc processes never see a partial file,
+    // and the least recently used entries are evicted once the cache grows beyond its size limit.
+    class CompileCache
+    {
+    public:
+        CompileCache(const std::string &dir, uint64_t maxBytes);
+        ~CompileCache() = default;
+
+        // Returns false (and sets error) if the cache directory cannot be created
+        bool init(std::string &error);
+
+        // Hash of the contents of input, SPC_VERSION, the LLVM version and flags, and of
+        // the contents of deps, other files the output depends on (e.g. a -fprofile-use profile).
+        // Returns an empty string if input or one of deps cannot be read.
+        static std::string key(const std::string &input, const std::string &flags, const std::vector<std::string> &deps = {});
+
+        // Copies the entry for key to output, and for a unit the interface file stored with it to
+        // interface. Returns false on a miss.
+        bool fetch(const std::string &key, const std::string &output, const std::string &interface = "");
+        // Adds output, and the interface file of a unit, to the cache under key, then evicts old entries if needed
+        void store(const std::string &key, const std::string &output, const std::string &interface = "");
+
+        unsigned hits() const { return _hits; }
+        unsigned misses() const { return _misses; }
+        // Adds the hits and misses of this run to the totals kept in the cache directory and prints them
+        void printStats(std::ostream &os);
+
+    private:
+        std::string dir;
+        uint64_t maxBytes;
+        std::atomic<unsigned> _hits, _misses;
+
+        std::string entryPath(const std::string &key) const;
+        void evict();
+    };
+
+} // namespace spc
+
+#endif
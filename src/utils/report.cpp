@@ -0,0 +1,119 @@
+#include "report.hpp"
+
+#include <cstdio>
+#include <iomanip>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace spc;
+
+spc::CompileReport::Scope::Scope(CompileReport *report, Kind kind, const std::string &name)
+    : report(report), list(nullptr), idx(0), rssKB(0)
+{
+    if (report == nullptr) return;
+    list = kind == Kind::Phase ? &report->phases : &report->routines;
+    for (idx = 0; idx < list->size(); ++idx)
+        if ((*list)[idx].name == name) break;
+    if (idx == list->size())
+    {
+        list->emplace_back();
+        list->back().name = name;
+    }
+    rssKB = currentRSS();
+    start = std::chrono::steady_clock::now();
+}
+
+spc::CompileReport::Scope::~Scope()
+{
+    if (report == nullptr) return;
+    auto &e = (*list)[idx];
+    auto now = std::chrono::steady_clock::now();
+    e.ms += std::chrono::duration<double, std::milli>(now - start).count();
+    report->totalMs = std::chrono::duration<double, std::milli>(now - report->created).count();
+    e.rssKB = currentRSS();
+    e.deltaKB += e.rssKB - rssKB;
+    report->peakKB = peakRSS();
+}
+
+long spc::CompileReport::currentRSS()
+{
+    long pages = 0, rss = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == nullptr) return 0;
+    if (fscanf(f, "%ld %ld", &pages, &rss) != 2) rss = 0;
+    fclose(f);
+    return rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+long spc::CompileReport::peakRSS()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;  // KB on Linux
+}
+
+void spc::CompileReport::printTimeTable(std::ostream &os) const
+{
+    os << "Time report for " << input << ":" << std::endl;
+    os << std::left << std::setw(40) << std::setfill('-') << '+' << std::setw(15) << '+' << std::setw(10) << '+' << '+' << std::endl;
+    os << '|' << std::setfill(' ') << std::setw(39) << "Phase" << '|' << std::setw(14) << "Wall (ms)" << '|' << std::setw(9) << "%" << '|' << std::endl;
+    os << std::left << std::setw(40) << std::setfill('-') << '+' << std::setw(15) << '+' << std::setw(10) << '+' << '+' << std::endl;
+    os << std::fixed << std::setprecision(3) << std::setfill(' ');
+    for (auto &e : phases)
+        os << '|' << std::setw(39) << e.name << '|' << std::setw(14) << e.ms << '|' << std::setw(9) << std::setprecision(1) << (totalMs > 0 ? e.ms * 100 / totalMs : 0) << std::setprecision(3) << '|' << std::endl;
+    for (auto &e : routines)
+        os << '|' << std::setw(39) << ("  routine " + e.name) << '|' << std::setw(14) << e.ms << '|' << std::setw(9) << "" << '|' << std::endl;
+    os << std::left << std::setw(40) << std::setfill('-') << '+' << std::setw(15) << '+' << std::setw(10) << '+' << '+' << std::endl;
+    os << std::setfill(' ') << "Total: " << std::setprecision(3) << totalMs << " ms" << std::endl;
+    for (auto &e : phases)
+        if (e.name == "Parsing" && e.ms > 0)
+            os << "Parsing throughput: " << std::setprecision(2) << inputBytes / 1048576.0 / (e.ms / 1000) << " MB/s ("
+               << inputBytes << " bytes)" << std::endl;
+}
+
+void spc::CompileReport::printMemTable(std::ostream &os) const
+{
+    os << "Memory report for " << input << ":" << std::endl;
+    os << std::left << std::setw(40) << std::setfill('-') << '+' << std::setw(15) << '+' << std::setw(15) << '+' << '+' << std::endl;
+    os << '|' << std::setfill(' ') << std::setw(39) << "Phase" << '|' << std::setw(14) << "RSS (KB)" << '|' << std::setw(14) << "Delta (KB)" << '|' << std::endl;
+    os << std::left << std::setw(40) << std::setfill('-') << '+' << std::setw(15) << '+' << std::setw(15) << '+' << '+' << std::endl;
+    os << std::setfill(' ');
+    for (auto &e : phases)
+        os << '|' << std::setw(39) << e.name << '|' << std::setw(14) << e.rssKB << '|' << std::setw(14) << e.deltaKB << '|' << std::endl;
+    os << std::left << std::setw(40) << std::setfill('-') << '+' << std::setw(15) << '+' << std::setw(15) << '+' << '+' << std::endl;
+    os << std::setfill(' ') << "Peak RSS: " << peakKB << " KB" << std::endl;
+    os << "AST arena: " << astBytes / 1024 << " KB" << std::endl;
+}
+
+static std::string jsonEscape(const std::string &s)
+{
+    std::string ret;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\') ret += '\\';
+        ret += c;
+    }
+    return ret;
+}
+
+void spc::CompileReport::printJSON(std::ostream &os) const
+{
+    auto printEntries = [&os](const std::vector<Entry> &list)
+    {
+        os << '[';
+        for (size_t i = 0; i < list.size(); ++i)
+        {
+            auto &e = list[i];
+            os << (i == 0 ? "" : ", ") << "{\"name\": \"" << jsonEscape(e.name) << "\", \"ms\": " << e.ms
+               << ", \"rss_kb\": " << e.rssKB << ", \"delta_kb\": " << e.deltaKB << '}';
+        }
+        os << ']';
+    };
+    os << std::fixed << std::setprecision(3);
+    os << "{\"input\": \"" << jsonEscape(input) << "\", \"input_bytes\": " << inputBytes << ", \"ast_bytes\": " << astBytes << ", \"total_ms\": " << totalMs
+       << ", \"peak_rss_kb\": " << peakKB << ", \"phases\": ";
+    printEntries(phases);
+    os << ", \"routines\": ";
+    printEntries(routines);
+    os << '}';
+}
@@ -0,0 +1,72 @@
+#ifndef __REPORT__H__
+#define __REPORT__H__
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace spc
+{
+
+    // Time and memory spent in each phase of one compilation (-ftime-report / -fmem-report)
+    class CompileReport
+    {
+    public:
+        enum Kind { Phase, Routine };
+        struct Entry
+        {
+            std::string name;
+            double ms = 0;
+            long rssKB = 0;     // resident set size when the phase last finished
+            long deltaKB = 0;   // growth of the resident set size during the phase
+        };
+
+        // Records the time and memory between its construction and destruction.
+        // A null report makes it a no-op, so callers need not check whether reporting is on.
+        class Scope
+        {
+        public:
+            Scope(CompileReport *report, Kind kind, const std::string &name);
+            ~Scope();
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+        private:
+            CompileReport *report;
+            std::vector<Entry> *list;
+            size_t idx;
+            long rssKB;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        explicit CompileReport(const std::string &input)
+            : input(input), created(std::chrono::steady_clock::now()) {}
+        ~CompileReport() = default;
+
+        // Size of the source, to report the parsing throughput
+        void setInputBytes(size_t bytes) { inputBytes = bytes; }
+        // Memory taken by the AST nodes
+        void setASTBytes(size_t bytes) { astBytes = bytes; }
+
+        void printTimeTable(std::ostream &os) const;
+        void printMemTable(std::ostream &os) const;
+        void printJSON(std::ostream &os) const;
+
+        static long currentRSS();
+        static long peakRSS();
+
+    private:
+        std::string input;
+        // Entries keep the order in which phases are first entered; re-entering a phase accumulates
+        std::vector<Entry> phases, routines;
+        long peakKB = 0;
+        size_t inputBytes = 0, astBytes = 0;
+        // Phases nest (LLVM passes run inside code generation), so percentages are
+        // taken against the wall time from creation to the end of the last phase
+        std::chrono::steady_clock::time_point created;
+        double totalMs = 0;
+    };
+
+} // namespace spc
+
+#endif
@@ -0,0 +1,63 @@
+#include "source_buffer.hpp"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace spc;
+
+spc::SourceBuffer::~SourceBuffer()
+{
+    if (mapped != 0)
+        munmap(base, mapped);
+}
+
+void spc::SourceBuffer::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Error: cannot open input file " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        size_t page = sysconf(_SC_PAGESIZE);
+        length = st.st_size;
+        // Reserve zeroed anonymous memory with room for the sentinels, then map the file over its start.
+        // The tail of the file's last page reads as zeros, and so does the anonymous page after it
+        // when the file ends within two bytes of a page boundary, so the sentinels need no copying.
+        size_t fileMapped = (length + page - 1) / page * page;
+        size_t total = (length + 2 + page - 1) / page * page;
+        void *p = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            if (fileMapped == 0 || mmap(p, fileMapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED)
+            {
+                base = static_cast<char *>(p);
+                mapped = total;
+                // The scanner reads the source once from front to back
+                madvise(base, total, MADV_SEQUENTIAL);
+                close(fd);
+                return;
+            }
+            munmap(p, total);
+        }
+    }
+
+    // Not mappable: read it whole
+    copy.clear();
+    char chunk[65536];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+        copy.insert(copy.end(), chunk, chunk + n);
+    close(fd);
+    if (n < 0)
+        throw std::runtime_error("Error: cannot read input file " + path);
+    length = copy.size();
+    copy.push_back('\0');
+    copy.push_back('\0');
+    base = copy.data();
+}
@@ -0,0 +1,41 @@
+#ifndef __SOURCE_BUFFER__H__
+#define __SOURCE_BUFFER__H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace spc
+{
+
+    // A whole source file in memory, followed by the two NUL bytes flex's yy_scan_buffer expects.
+    // Regular files are mapped copy-on-write, so the scanner works on the page cache directly;
+    // anything that cannot be mapped (pipes, ...) is read into a heap buffer instead.
+    class SourceBuffer
+    {
+    public:
+        SourceBuffer() = default;
+        ~SourceBuffer();
+        SourceBuffer(const SourceBuffer &) = delete;
+        SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+        // Throws std::runtime_error if the file cannot be read
+        void open(const std::string &path);
+
+        // Writable: flex temporarily stores a NUL after the current token
+        char *data() { return base; }
+        // Size of the source, without the sentinels
+        size_t size() const { return length; }
+        // Size to hand to yy_scan_buffer, including the sentinels
+        size_t scanSize() const { return length + 2; }
+
+    private:
+        char *base = nullptr;
+        size_t length = 0;
+        size_t mapped = 0;          // bytes mapped, 0 if base points into copy
+        std::vector<char> copy;
+    };
+
+} // namespace spc
+
+#endif
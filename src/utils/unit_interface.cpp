@@ -0,0 +1,406 @@
+#include "unit_interface.hpp"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <stdexcept>
+
+namespace spc
+{
+
+    static const char magic[] = {'S', 'P', 'I'};
+    // Bump whenever the layout changes
+    static const uint8_t version = 1;
+
+    // How a type or an array bound is stored, followed by its contents
+    enum TypeTag : uint8_t { VoidTag, SimpleTag, StringTag, AliasTag, RecordTag, ArrayTag };
+    enum BoundTag : uint8_t { ConstBound, IdBound };
+
+    class UnitInterface::Writer
+    {
+    private:
+        llvm::raw_string_ostream os;
+        llvm::support::endian::Writer out;
+
+    public:
+        explicit Writer(std::string &buffer) : os(buffer), out(os, llvm::support::little) {}
+
+        void u8(uint8_t v) { out.write<uint8_t>(v); }
+        void u32(uint32_t v) { out.write<uint32_t>(v); }
+        void str(llvm::StringRef s) { u32(s.size()); os << s; }
+
+        void writeValue(ConstValueNode *val)
+        {
+            u8(val->type);
+            switch (val->type)
+            {
+                case Type::Int: u32(static_cast<uint32_t>(cast_node<IntegerNode>(val)->val)); break;
+                case Type::Real: out.write<uint64_t>(llvm::DoubleToBits(cast_node<RealNode>(val)->val)); break;
+                case Type::Char: u8(cast_node<CharNode>(val)->val); break;
+                case Type::Bool: u8(cast_node<BooleanNode>(val)->val); break;
+                case Type::String: str(cast_node<StringNode>(val)->val); break;
+                default: throw std::logic_error("Unknown const value in unit interface");
+            }
+        }
+
+        void writeBound(ExprNode *bound)
+        {
+            if (auto *id = cast_node<IdentifierNode>(bound))
+            {
+                u8(IdBound);
+                str(id->name);
+            }
+            else
+            {
+                u8(ConstBound);
+                writeValue(cast_node<ConstValueNode>(bound));
+            }
+        }
+
+        void writeType(TypeNode *type)
+        {
+            switch (type->getKind())
+            {
+                case NodeKind::VoidType: u8(VoidTag); break;
+                case NodeKind::SimpleType: u8(SimpleTag); u8(type->type); break;
+                case NodeKind::StringType: u8(StringTag); break;
+                case NodeKind::AliasType: u8(AliasTag); str(cast_node<AliasTypeNode>(type)->name->name); break;
+                case NodeKind::RecordType:
+                {
+                    auto &fields = cast_node<RecordTypeNode>(type)->field;
+                    u8(RecordTag);
+                    u32(fields.size());
+                    for (auto *field : fields)
+                    {
+                        str(field->name->name);
+                        writeType(field->type);
+                    }
+                    break;
+                }
+                case NodeKind::ArrayType:
+                {
+                    auto *arr = cast_node<ArrayTypeNode>(type);
+                    u8(ArrayTag);
+                    writeBound(arr->range_start);
+                    writeBound(arr->range_end);
+                    writeType(arr->itemType);
+                    break;
+                }
+                default: throw std::logic_error("Unknown type in unit interface");
+            }
+        }
+
+        void writeUnit(UnitNode *unit)
+        {
+            os.write(magic, sizeof(magic));
+            u8(version);
+            str(unit->name->name);
+            u32(unit->interfaceUses->getChildren().size());
+            for (auto *use : unit->interfaceUses->getChildren())
+                str(use->name);
+
+            auto *head = unit->interfaceHead;
+            u32(head->constList->getChildren().size());
+            for (auto *decl : head->constList->getChildren())
+            {
+                str(decl->name->name);
+                writeValue(decl->val);
+            }
+            u32(head->typeList->getChildren().size());
+            for (auto *decl : head->typeList->getChildren())
+            {
+                str(decl->name->name);
+                writeType(decl->type);
+            }
+            u32(head->varList->getChildren().size());
+            for (auto *decl : head->varList->getChildren())
+            {
+                str(decl->name->name);
+                writeType(decl->type);
+            }
+            u32(head->subroutineList->getChildren().size());
+            for (auto *routine : head->subroutineList->getChildren())
+            {
+                str(routine->name->name);
+                writeType(routine->retType);
+                u32(routine->params->getChildren().size());
+                for (auto *param : routine->params->getChildren())
+                {
+                    str(param->name->name);
+                    u8(param->mode);
+                    writeType(param->type);
+                }
+            }
+            os.flush();
+        }
+    };
+
+    class UnitInterface::Reader
+    {
+    private:
+        const std::string &path;
+        llvm::StringRef data;
+
+        [[noreturn]] void corrupt() { throw std::runtime_error("Corrupt unit interface file: " + path); }
+        void need(size_t n) { if (data.size() < n) corrupt(); }
+
+    public:
+        Reader(const std::string &path, llvm::StringRef data) : path(path), data(data) {}
+
+        uint8_t u8()
+        {
+            need(1);
+            uint8_t v = data.front();
+            data = data.drop_front(1);
+            return v;
+        }
+        uint32_t u32()
+        {
+            need(4);
+            uint32_t v = llvm::support::endian::read32le(data.data());
+            data = data.drop_front(4);
+            return v;
+        }
+        uint64_t u64()
+        {
+            need(8);
+            uint64_t v = llvm::support::endian::read64le(data.data());
+            data = data.drop_front(8);
+            return v;
+        }
+        std::string str()
+        {
+            uint32_t n = u32();
+            need(n);
+            std::string s = data.take_front(n);
+            data = data.drop_front(n);
+            return s;
+        }
+        IdentifierNode *id() { return make_node<IdentifierNode>(str()); }
+
+        // Everything up to the interface itself; needs no ASTArena
+        void readPrologue(std::string &name, std::vector<std::string> &uses)
+        {
+            need(sizeof(magic) + 1);
+            if (!data.startswith(llvm::StringRef(magic, sizeof(magic)))) corrupt();
+            data = data.drop_front(sizeof(magic));
+            if (u8() != version)
+                throw std::runtime_error("Unit interface file " + path + " was written by another version of spc, recompile the unit");
+            name = str();
+            for (uint32_t n = u32(); n > 0; n--)
+                uses.push_back(str());
+        }
+
+        ConstValueNode *readValue()
+        {
+            switch (u8())
+            {
+                case Type::Int: return make_node<IntegerNode>(static_cast<int>(u32()));
+                case Type::Real: return make_node<RealNode>(llvm::BitsToDouble(u64()));
+                case Type::Char: return make_node<CharNode>(static_cast<char>(u8()));
+                case Type::Bool: return make_node<BooleanNode>(u8() != 0);
+                case Type::String: return make_node<StringNode>(str());
+                default: corrupt();
+            }
+        }
+
+        ExprNode *readBound()
+        {
+            switch (u8())
+            {
+                case ConstBound: return readValue();
+                case IdBound: return id();
+                default: corrupt();
+            }
+        }
+
+        TypeNode *readType()
+        {
+            switch (u8())
+            {
+                case VoidTag: return make_node<VoidTypeNode>();
+                case SimpleTag:
+                {
+                    uint8_t type = u8();
+                    if (type > Type::Alias) corrupt();
+                    return make_node<SimpleTypeNode>(static_cast<Type>(type));
+                }
+                case StringTag: return make_node<StringTypeNode>();
+                case AliasTag: return make_node<AliasTypeNode>(id());
+                case RecordTag:
+                {
+                    uint32_t n = u32();
+                    if (n == 0) corrupt();
+                    RecordTypeNode *record = nullptr;
+                    for (uint32_t i = 0; i < n; i++)
+                    {
+                        auto *name = id();
+                        auto *type = readType();
+                        if (record == nullptr)
+                            record = make_node<RecordTypeNode>(make_node<IdentifierList>(name), type);
+                        else
+                            record->append(make_node<VarDeclNode>(name, type));
+                    }
+                    return record;
+                }
+                case ArrayTag:
+                {
+                    auto *start = readBound();
+                    auto *end = readBound();
+                    auto *itemType = readType();
+                    return make_node<ArrayTypeNode>(start, end, itemType);
+                }
+                default: corrupt();
+            }
+        }
+
+        UnitNode *readUnit()
+        {
+            std::string name;
+            std::vector<std::string> useNames;
+            readPrologue(name, useNames);
+            auto *uses = make_node<IdentifierList>();
+            for (auto &use : useNames)
+                uses->append(make_node<IdentifierNode>(use));
+
+            auto *consts = make_node<ConstDeclList>();
+            for (uint32_t n = u32(); n > 0; n--)
+            {
+                auto *constName = id();
+                consts->append(make_node<ConstDeclNode>(constName, readValue()));
+            }
+            auto *types = make_node<TypeDeclList>();
+            for (uint32_t n = u32(); n > 0; n--)
+            {
+                auto *typeName = id();
+                types->append(make_node<TypeDeclNode>(typeName, readType()));
+            }
+            auto *vars = make_node<VarDeclList>();
+            for (uint32_t n = u32(); n > 0; n--)
+            {
+                auto *varName = id();
+                vars->append(make_node<VarDeclNode>(varName, readType()));
+            }
+            auto *routines = make_node<RoutineList>();
+            for (uint32_t n = u32(); n > 0; n--)
+            {
+                auto *routineName = id();
+                auto *retType = readType();
+                auto *params = make_node<ParamList>();
+                for (uint32_t m = u32(); m > 0; m--)
+                {
+                    auto *paramName = id();
+                    uint8_t mode = u8();
+                    if (mode > ParamMode::ByConst) corrupt();
+                    params->append(make_node<ParamNode>(paramName, readType(), static_cast<ParamMode>(mode)));
+                }
+                routines->append(make_node<RoutineNode>(routineName, nullptr, nullptr, params, retType));
+            }
+            if (!data.empty()) corrupt();
+
+            auto *interfaceHead = make_node<RoutineHeadNode>(consts, vars, types, routines);
+            // The implementation stays in the unit's object
+            auto *implementation = make_node<RoutineHeadNode>(make_node<ConstDeclList>(), make_node<VarDeclList>(), make_node<TypeDeclList>(), make_node<RoutineList>());
+            return make_node<UnitNode>(make_node<IdentifierNode>(name), uses, interfaceHead, make_node<IdentifierList>(), implementation);
+        }
+    };
+
+    bool UnitInterface::write(UnitNode *unit, const std::string &path, std::string &error)
+    {
+        std::string data;
+        Writer(data).writeUnit(unit);
+
+        // An unchanged interface keeps the users of the unit up to date for make and the cache
+        auto old = llvm::MemoryBuffer::getFile(path);
+        if (old && (*old)->getBuffer() == data)
+            return true;
+
+        // Published with a rename, so that a parallel compilation never reads half a file
+        int fd;
+        llvm::SmallString<128> tmp;
+        if (auto ec = llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, tmp))
+        {
+            error = "Could not create file: " + ec.message();
+            return false;
+        }
+        {
+            llvm::raw_fd_ostream out(fd, true);
+            out << data;
+        }
+        if (auto ec = llvm::sys::fs::rename(tmp, path))
+        {
+            llvm::sys::fs::remove(tmp);
+            error = "Could not write " + path + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    UnitNode *UnitInterface::read(const std::string &path)
+    {
+        auto buffer = llvm::MemoryBuffer::getFile(path);
+        if (!buffer)
+            throw std::runtime_error("Could not read " + path + ": " + buffer.getError().message());
+        return Reader(path, (*buffer)->getBuffer()).readUnit();
+    }
+
+    std::string UnitInterface::find(const std::string &unit, const std::vector<std::string> &unitPath)
+    {
+        for (auto &dir : unitPath)
+        {
+            llvm::SmallString<128> path(dir);
+            llvm::sys::path::append(path, unit + ".spi");
+            if (llvm::sys::fs::exists(path))
+                return path.str();
+        }
+        return "";
+    }
+
+    bool UnitInterface::collect(const std::vector<std::string> &uses, const std::vector<std::string> &unitPath,
+                                std::vector<std::string> &files, std::string &error)
+    {
+        std::vector<std::string> pending(uses.rbegin(), uses.rend());
+        llvm::StringSet<> seen;
+        while (!pending.empty())
+        {
+            std::string unit = pending.back();
+            pending.pop_back();
+            if (!seen.insert(unit).second)
+                continue;
+            std::string path = find(unit, unitPath);
+            if (path.empty())
+            {
+                error = "Unit not found: " + unit + " (no " + unit + ".spi in the unit path)";
+                return false;
+            }
+            auto buffer = llvm::MemoryBuffer::getFile(path);
+            if (!buffer)
+            {
+                error = "Could not read " + path + ": " + buffer.getError().message();
+                return false;
+            }
+            try
+            {
+                std::string name;
+                std::vector<std::string> unitUses;
+                Reader(path, (*buffer)->getBuffer()).readPrologue(name, unitUses);
+                pending.insert(pending.end(), unitUses.rbegin(), unitUses.rend());
+            }
+            catch (const std::runtime_error &e)
+            {
+                error = e.what();
+                return false;
+            }
+            files.push_back(path);
+        }
+        return true;
+    }
+
+} // namespace spc
@@ -0,0 +1,44 @@
+#ifndef __UNIT_INTERFACE__H__
+#define __UNIT_INTERFACE__H__
+
+#include "utils/ast.hpp"
+
+#include <string>
+#include <vector>
+
+namespace spc
+{
+
+    // Interface file (.spi) of a unit: the uses clause, consts, types, vars and routine headings
+    // of its interface section in a compact binary form. It is written when the unit is parsed
+    // and read back by the uses clauses of other sources, which never see the unit's source.
+    //
+    // Layout, all integers little endian, strings as a u32 length followed by the bytes:
+    //   "SPI" version:u8 name uses:(u32 count, names) consts types vars routines
+    // Names are lower-cased like every identifier. Types are stored as written, aliases
+    // by name, so reading a file needs nothing but the file.
+    class UnitInterface
+    {
+    public:
+        // Writes the interface of unit to path. The file is left alone, modification time
+        // included, if it already holds the same interface. Returns false and sets error on failure.
+        static bool write(UnitNode *unit, const std::string &path, std::string &error);
+        // Rebuilds the unit from path, with the nodes allocated in the current ASTArena.
+        // Throws std::runtime_error if the file cannot be read or is not an interface file.
+        static UnitNode *read(const std::string &path);
+
+        // Path of <unit>.spi in the first directory of unitPath containing it, or "" if there is none
+        static std::string find(const std::string &unit, const std::vector<std::string> &unitPath);
+        // Appends the interface files of uses and of the units their interfaces use to files,
+        // each once. Returns false and sets error if one of them cannot be found or read.
+        static bool collect(const std::vector<std::string> &uses, const std::vector<std::string> &unitPath,
+                            std::vector<std::string> &files, std::string &error);
+
+    private:
+        class Writer;
+        class Reader;
+    };
+
+} // namespace spc
+
+#endif
@@ -9,16 +9,17 @@ namespace spc
 
     template<typename T, typename U>
     inline typename std::enable_if<std::is_base_of<BaseNode, U>::value && std::is_base_of<BaseNode, T>::value, bool>::type 
-    is_ptr_of(const std::shared_ptr<U> &ptr)
+    is_ptr_of(U *ptr)
     {
-        return dynamic_cast<T *>(ptr.get()) != nullptr;
+        // T::classof compares the kind tag of the node, see NodeKind
+        return ptr != nullptr && T::classof(ptr);
     }
 
     template<typename T, typename U>
-    inline typename std::enable_if<std::is_base_of<BaseNode, U>::value && std::is_base_of<BaseNode, T>::value, std::shared_ptr<T>>::type
-    cast_node(const std::shared_ptr<U> &ptr)
+    inline typename std::enable_if<std::is_base_of<BaseNode, U>::value && std::is_base_of<BaseNode, T>::value, T *>::type
+    cast_node(U *ptr)
     {
-        return std::dynamic_pointer_cast<T>(ptr);
+        return is_ptr_of<T>(ptr) ? static_cast<T *>(ptr) : nullptr;
     }
     
 } // namespace spc
@@ -0,0 +1,165 @@
+#!/bin/sh
+# Compiles the programs in test/bench with spc and times them, and times
+# spc itself on generated sources.
+# Usage: test/bench/bench.sh <directory of spc and libspcrt.a> [-O level]...
+# The levels default to -O0 -O1 -O2 -O3; CC links the objects and builds the C
+# baselines (cc by default), TIME is GNU time (/usr/bin/time by default).
+set -e
+[ $# -ge 1 ] || { echo "usage: $0 <build dir> [-O level]..." >&2; exit 2; }
+bin=$(cd "$1" && pwd)
+shift
+levels=${*:--O0 -O1 -O2 -O3}
+src=$(cd "$(dirname "$0")" && pwd)
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+# spc writes compile.log to the current directory
+cd "$out"
+
+# Runs a command and prints its wall time after label
+timed()
+{
+    label=$1
+    shift
+    start=$(date +%s.%N)
+    "$@"
+    end=$(date +%s.%N)
+    awk -v l="$label" -v s="$start" -v e="$end" 'BEGIN { printf "%-24s %8.3f s\n", l, e - s }' >&2
+}
+
+# Like timed, and also prints the MB/s of file, which the command writes or reads; a MB is
+# 2^20 bytes, as in the parsing throughput of -ftime-report
+streamed()
+{
+    label=$1
+    file=$2
+    shift 2
+    start=$(date +%s.%N)
+    "$@"
+    end=$(date +%s.%N)
+    awk -v l="$label" -v s="$start" -v e="$end" -v n="$(wc -c <"$file")" \
+        'BEGIN { printf "%-24s %8.3f s %8.1f MB/s\n", l, e - s, n / (e - s) / 1048576 }' >&2
+}
+
+# Runs a command under GNU time, TIME or /usr/bin/time, and prints its wall time and peak RSS
+measured()
+{
+    label=$1
+    shift
+    ${TIME:-/usr/bin/time} -v -o "$out/time.txt" "$@"
+    awk -v l="$label" -F': ' '/Elapsed/ { n = split($2, t, ":"); for (i = 1; i <= n; i++) s = s * 60 + t[i] }
+        /Maximum resident/ { m = $2 }
+        END { printf "%-24s %8.3f s %8.1f MB\n", l, s, m / 1024 }' "$out/time.txt" >&2
+}
+
+# Compiles test/bench/<name>.pas at level into $out/<name>. The source is copied to $out first
+# as spc writes the AST next to it. spc emits position dependent code, so the program is not
+# linked as a PIE.
+build()
+{
+    cp "$src/$1.pas" "$out/$1.pas"
+    "$bin/spc" "$2" -c "$out/$1.pas" -o "$out/$1.o" >/dev/null
+    ${CC:-cc} "$out/$1.o" -L"$bin" -lspcrt -lm -no-pie -o "$out/$1"
+}
+
+# A program of 5000 routines that only the compile time is measured on
+awk 'BEGIN {
+    print "program big;"
+    print "var"
+    print "  g: integer;"
+    for (k = 1; k <= 5000; k++) {
+        printf "procedure p%d(a: integer);\nvar\n  x, y: integer;\nbegin\n", k
+        printf "  x := a + %d;\n  y := x * 2;\n", k
+        print "  if y > 10 then g := g + y else g := g - x;"
+        print "end;"
+    }
+    print "begin"
+    print "  g := 0;"
+    for (k = 1; k <= 5000; k++) printf "  p%d(g);\n", k
+    print "  writeln(g);"
+    print "end."
+}' >"$out/big.pas"
+
+# The parsing throughput on it, from -ftime-report
+"$bin/spc" -ftime-report -ir "$out/big.pas" -o "$out/big.ll" 2>&1 >/dev/null |
+    awk -F'|' '/^\|Parsing/ { ms = $3 }
+        /^Parsing throughput/ { split($0, f, " "); printf "%-24s %8.3f s %8.1f MB/s\n", "parse big", ms / 1000, f[3] }' >&2
+
+# Routines nested three deep, each declaring the same names again and using records through
+# chains of fields, as spc has no with statement
+awk 'BEGIN {
+    print "program nested;"
+    print "type"
+    print "  vec = record x, y: integer; end;"
+    print "  body = record pos, vel: vec; mass: integer; end;"
+    print "var"
+    print "  g: integer;"
+    for (k = 1; k <= 2000; k++) {
+        printf "procedure p%d(n: integer);\nvar\n  b: body;\n  i: integer;\n", k
+        printf "  procedure q%d(n: integer);\n  var\n    b: body;\n    i: integer;\n", k
+        printf "    procedure r%d(n: integer);\n    var\n      b: body;\n      i: integer;\n    begin\n", k
+        print  "      b.pos.x := n; b.pos.y := 0; b.vel.x := 1; b.vel.y := 2; b.mass := 3;"
+        print  "      for i := 1 to n do"
+        print  "      begin"
+        print  "        b.pos.x := b.pos.x + b.vel.x * i;"
+        print  "        b.pos.y := b.pos.y + b.vel.y * i;"
+        print  "        g := g + b.pos.x - b.pos.y + b.mass;"
+        print  "      end;"
+        print  "    end;"
+        print  "  begin"
+        print  "    b.vel.x := n; b.vel.y := n + 1; b.mass := n * 2;"
+        printf "    for i := 1 to 2 do r%d(b.vel.x + b.vel.y + b.mass + i);\n", k
+        print  "  end;"
+        print  "begin"
+        print  "  b.mass := n;"
+        printf "  for i := 1 to 2 do q%d(b.mass + i);\n", k
+        print  "end;"
+    }
+    print "begin"
+    print "  g := 0;"
+    for (k = 1; k <= 2000; k++) printf "  p%d(%d);\n", k, k % 5
+    print "  writeln(g);"
+    print "end."
+}' >"$out/nested.pas"
+
+# Its parse and code generation times and the peak RSS of spc, from -ftime-report and -fmem-report
+"$bin/spc" -ir -ftime-report -fmem-report "$out/nested.pas" -o "$out/nested.ll" 2>&1 >/dev/null |
+    awk -F'|' '/^Time report/ { mem = 0 }
+        /^Memory report/ { mem = 1 }
+        /^\|Parsing/ && !mem { printf "%-24s %8.3f s\n", "parse nested", $3 / 1000 }
+        /^\|Code generation/ && !mem { printf "%-24s %8.3f s\n", "codegen nested", $3 / 1000 }
+        /^Peak RSS/ { split($0, f, " "); printf "%-24s %8.1f MB\n", "peak rss nested", f[3] / 1024 }
+        /^AST arena/ { split($0, f, " "); printf "%-24s %8.1f MB\n", "ast arena nested", f[3] / 1024 }' >&2
+
+# Programs with one large global array, that the compile time and memory of spc must not grow with
+for n in 100000 1000000 10000000 50000000
+do
+    awk -v n=$n 'BEGIN {
+        print "program bigarr;"
+        print "var"
+        printf "  a: array [1..%d] of integer;\n  r: array [1..%d] of real;\n  i: integer;\n", n, n / 50
+        print "begin"
+        printf "  for i := 1 to %d do a[i] := i mod 7;\n  r[%d] := 0.5;\n", n, n / 50
+        printf "  writeln(a[%d], %c %c, r[%d]);\n", n, 39, 39, n / 50
+        print "end."
+    }' >"$out/bigarr.pas"
+    measured "compile bigarr $n" "$bin/spc" -c "$out/bigarr.pas" -o "$out/bigarr.o" >/dev/null
+done
+
+for level in $levels
+do
+    timed "compile $level" "$bin/spc" "$level" -c "$out/big.pas" -o "$out/big.o" >/dev/null
+    build loops "$level"
+    timed "loops $level" "$out/loops" >/dev/null
+    build writes "$level"
+    streamed "writes $level" "$out/numbers.txt" "$out/writes" >"$out/numbers.txt"
+    build reads "$level"
+    streamed "reads $level" "$out/numbers.txt" "$out/reads" <"$out/numbers.txt" >/dev/null
+done
+
+# The same output through one printf call per value, the way writeln was compiled before
+${CC:-cc} -O2 "$src/writes_printf.c" -o "$out/writes_printf"
+streamed "writes printf" "$out/printf.txt" "$out/writes_printf" >"$out/printf.txt"
+
+# The same input through one scanf call per value, the way read and readln were compiled before
+${CC:-cc} -O2 "$src/reads_scanf.c" -o "$out/reads_scanf"
+streamed "reads scanf" "$out/numbers.txt" "$out/reads_scanf" <"$out/numbers.txt" >/dev/null
@@ -0,0 +1,51 @@
+program loops;
+type
+  row = array [1..300] of integer;
+var
+  a, b, c: array [1..4000000] of integer;
+  x, y, z: array [1..300] of row;
+  i, j, r, s: integer;
+{c := a + k * b}
+procedure saxpy(n, k: integer);
+var
+  i: integer;
+begin
+  for i := 1 to n do c[i] := a[i] + k * b[i];
+end;
+{z := x * y, the inner loop walks rows}
+procedure matmul(n: integer);
+var
+  i, j, k, t: integer;
+begin
+  for i := 1 to n do
+    for j := 1 to n do z[i][j] := 0;
+  for i := 1 to n do
+    for k := 1 to n do
+    begin
+      t := x[i][k];
+      for j := 1 to n do z[i][j] := z[i][j] + t * y[k][j];
+    end;
+end;
+{main}
+begin
+  for i := 1 to 4000000 do
+  begin
+    a[i] := i mod 1000;
+    b[i] := 3 * (i mod 7);
+  end;
+  for r := 1 to 200 do saxpy(4000000, r);
+  s := 0;
+  for i := 1 to 4000000 do s := (s + c[i]) mod 1000003;
+  writeln(s);
+  for i := 1 to 300 do
+    for j := 1 to 300 do
+    begin
+      x[i][j] := (i + j) mod 10;
+      y[i][j] := (i * j) mod 10;
+    end;
+  for r := 1 to 20 do matmul(300);
+  s := 0;
+  for i := 1 to 300 do
+    for j := 1 to 300 do s := (s + z[i][j]) mod 1000003;
+  writeln(s);
+end.
@@ -0,0 +1,15 @@
+program reads;
+var
+  i, k, s: integer;
+  x, t: real;
+begin
+  s := 0;
+  t := 0.0;
+  for i := 1 to 5000000 do
+  begin
+    readln(k, x);
+    s := (s + k) mod 1000003;
+    t := t + x;
+  end;
+  writeln(s, ' ', t:0:1);
+end.
@@ -0,0 +1,20 @@
+/* reads.pas the way spc compiled it before libspcrt parsed the input:
+ * one scanf call per value, and readln skips the rest of the line with scanf and getchar. */
+#include <stdio.h>
+
+int main(void)
+{
+    int i, k = 0, s = 0;
+    double x = 0, t = 0;
+    for (i = 1; i <= 5000000; i++)
+    {
+        scanf("%d", &k);
+        scanf("%lf", &x);
+        scanf("%*[^\n]");
+        getchar();
+        s = (s + k) % 1000003;
+        t = t + x;
+    }
+    printf("%d %.1f\n", s, t);
+    return 0;
+}
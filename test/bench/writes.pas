@@ -0,0 +1,6 @@
+program writes;
+var
+  i: integer;
+begin
+  for i := 1 to 5000000 do writeln(i, ' ', i / 7);
+end.
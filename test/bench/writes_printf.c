@@ -0,0 +1,16 @@
+/* writes.pas the way spc compiled it before libspcrt buffered the output:
+ * one printf call per value and one for the newline. */
+#include <stdio.h>
+
+int main(void)
+{
+    int i;
+    for (i = 1; i <= 5000000; i++)
+    {
+        printf("%d", i);
+        printf("%c", ' ');
+        printf("%f", i / 7.0);
+        printf("\n");
+    }
+    return 0;
+}
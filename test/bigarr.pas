@@ -0,0 +1,10 @@
+program bigarr;
+var
+  a: array [1..50000000] of integer;
+  r: array [1..1000000] of real;
+  i: integer;
+begin
+  for i := 1 to 50000000 do a[i] := i mod 7;
+  r[1000000] := 0.5;
+  writeln(a[50000000], ' ', r[1000000]);
+end.
@@ -0,0 +1,20 @@
+program format;
+var
+  i: integer;
+  x: real;
+  st: string;
+begin
+  st := 'spc';
+  writeln('Test right-aligned fields');
+  for i := 1 to 5 do
+  begin
+    x := i / 3;
+    writeln(i:3, sqr(i):6, x:12:4, x:10:0, ':', chr(64 + i):3);
+  end;
+  writeln('Test precision 1 to 3: ', 3.14159:0:1, ' ', 3.14159:0:2, ' ', 3.14159:0:3);
+  writeln('Test default precision: ', -2.5, ' and width 12: ', -2.5:12);
+  writeln('Test string field: [', st:6, '] [', st:2, ']');
+  writeln('Test str(): ', str(-2147483647 - 1), ' ', str(0.1));
+  writeln('Test concat(): ', concat(1, ' ', 2.5, ' ', 'x'));
+  writeln('End test');
+end.
@@ -3,6 +3,12 @@ type
   rec = record s: string; ar: array [-1..1] of integer; end;
 var
   gr: array [0..1] of rec;
+  calls: integer;
+function next: integer;
+begin
+  calls := calls + 1;
+  next := calls mod 2;
+end;
 procedure test;
 var
   r: array [0..1] of rec;
@@ -20,6 +26,10 @@ begin
     writeln(length(gr[i].s) * length(r[i].s));
   end;
   writeln(sum);
+  {the index of an assigned field is evaluated once: prints 1 1}
+  calls := 0;
+  gr[next()].ar[0] := 7;
+  writeln(calls, ' ', gr[1].ar[0] div 7);
 end;
 {main}
 begin
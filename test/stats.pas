@@ -0,0 +1,69 @@
+unit stats;
+interface
+const
+  MAXN = 100;
+  title = 'stats';
+type
+  vec = array [1..100] of integer;
+  pair = record
+    lo, hi: integer;
+  end;
+var
+  calls: integer;
+
+function sum(var v: vec; n: integer): integer;
+function max(var v: vec; n: integer): integer;
+procedure report(var v: vec; n: integer);
+function width(const p: pair): integer;
+function total(const v: vec; n: integer): integer;
+procedure summary(const v: vec; n: integer);
+
+implementation
+var
+  last: integer;
+
+function sum(var v: vec; n: integer): integer;
+  var
+    i: integer;
+  begin
+    calls := calls + 1;
+    sum := 0;
+    for i := 1 to n do sum := sum + v[i];
+    last := sum;
+  end;
+
+function max(var v: vec; n: integer): integer;
+  var
+    i: integer;
+  begin
+    calls := calls + 1;
+    max := v[1];
+    for i := 2 to n do
+      if v[i] > max then max := v[i];
+  end;
+
+procedure report(var v: vec; n: integer);
+  begin
+    writeln(title, ': sum ', sum(v, n), ' max ', max(v, n), ' last ', last);
+  end;
+
+function width(const p: pair): integer;
+  begin
+    width := p.hi - p.lo;
+  end;
+
+{ calls total before its body, passing its own const param }
+procedure summary(const v: vec; n: integer);
+  begin
+    writeln(title, ': total ', total(v, n));
+  end;
+
+function total(const v: vec; n: integer): integer;
+  var
+    i: integer;
+  begin
+    total := 0;
+    for i := 1 to n do total := total + v[i];
+  end;
+
+end.
@@ -0,0 +1,26 @@
+program usesstats;
+uses stats;
+var
+  v: vec;
+  i, n: integer;
+  p: pair;
+
+procedure show(const q: pair);
+  begin
+    writeln('width ', width(q));
+  end;
+
+begin
+  read(n);
+  if n > MAXN then n := MAXN;
+  for i := 1 to n do v[i] := (i * 37) mod 11;
+  report(v, n);
+  p.lo := 0;
+  p.hi := max(v, n);
+  writeln(p.lo, ' ', p.hi);
+  show(p);
+  summary(v, n);
+  writeln(total(v, n));
+  writeln(sum(v, n));
+  writeln(calls);
+end.
@@ -0,0 +1,79 @@
+program varparam;
+type
+  vec = array [1..5] of integer;
+  point = record
+    x, y: integer;
+  end;
+var
+  a: vec;
+  p: point;
+  s: string;
+  i, n: integer;
+
+procedure swap(var x, y: integer);
+var
+  t: integer;
+begin
+  t := x;
+  x := y;
+  y := t;
+end;
+
+procedure fill(var v: vec; k: integer);
+var
+  i: integer;
+begin
+  for i := 1 to 5 do v[i] := i * k;
+end;
+
+function sum(const v: vec): integer;
+var
+  i: integer;
+begin
+  sum := 0;
+  for i := 1 to 5 do sum := sum + v[i];
+end;
+
+procedure move(var q: point; dx: integer);
+begin
+  q.x := q.x + dx;
+  q.y := q.y - dx;
+end;
+
+{v may be the same array as w: the read after the write sees the new value}
+function bump(const v: vec; var w: vec): integer;
+begin
+  bump := v[1];
+  w[1] := w[1] + 1;
+  bump := bump + v[1];
+end;
+
+{v may be the global a, which the routine writes}
+function touch(const v: vec): integer;
+begin
+  touch := v[2];
+  a[2] := a[2] + 1;
+  touch := touch + v[2];
+end;
+
+function len(const t: string): integer;
+begin
+  len := length(t);
+end;
+
+begin
+  i := 1;
+  n := 2;
+  swap(i, n);
+  writeln(i, ' ', n);
+  fill(a, 3);
+  writeln(sum(a));
+  {prints 7 13}
+  writeln(bump(a, a), ' ', touch(a));
+  p.x := 1;
+  p.y := 1;
+  move(p, 4);
+  writeln(p.x, ' ', p.y);
+  s := 'hello';
+  writeln(len(s), ' ', len('constant'));
+end.